@@ -0,0 +1,13 @@
+#-------------------------------------------------
+#
+# Программа и тесты одним проектом
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    app \
+    tests
+
+app.file = src/DSCreator.pro
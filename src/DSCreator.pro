@@ -6,17 +6,31 @@
 
 TEMPLATE = app
 
-QT += core gui widgets
+QT += core gui widgets concurrent
 
 SOURCES += \
+    actormodel.cpp \
+    batch.cpp \
     main.cpp \
     mainwindow.cpp \
+    names.cpp \
+    phrasemodel.cpp \
     script.cpp \
+    source.cpp \
+    timecode.cpp \
+    tokenizer.cpp \
     writer.cpp
 
 HEADERS += \
+    actormodel.h \
+    batch.h \
     mainwindow.h \
+    names.h \
+    phrasemodel.h \
     script.h \
+    source.h \
+    timecode.h \
+    tokenizer.h \
     writer.h
 
 FORMS += mainwindow.ui
@@ -0,0 +1,173 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "actormodel.h"
+#include "writer.h"
+#include <QHash>
+#include <algorithm>
+
+namespace
+{
+// Длительность вида "Ч:ММ:СС"
+QString DurationToString(const quint64 msecs)
+{
+    const quint64 secs = msecs / 1000u;
+    return QString("%1:%2:%3")
+            .arg(secs / 3600u)
+            .arg(secs / 60u % 60u, 2, 10, QChar('0'))
+            .arg(secs % 60u, 2, 10, QChar('0'));
+}
+}
+
+ActorModel::ActorModel(QObject* parent) :
+    QAbstractListModel(parent),
+    _checkedCount(0)
+{}
+
+int ActorModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _rows.size();
+}
+
+QVariant ActorModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= _rows.size()) return QVariant();
+
+    const int i = _rows.at(index.row());
+    const Actor& actor = _actors.at(i);
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QString("%1 (%2, %3)").arg(actor.name).arg(actor.lines).arg(DurationToString(actor.duration));
+
+    case Qt::ToolTipRole:
+        return QString("Строк: %1\nВремя: %2").arg(actor.lines).arg(DurationToString(actor.duration));
+
+    case Qt::CheckStateRole:
+        return _checked.testBit(i) ? Qt::Checked : Qt::Unchecked;
+    }
+    return QVariant();
+}
+
+bool ActorModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (Qt::CheckStateRole != role || !index.isValid() || index.row() >= _rows.size()) return false;
+
+    const int i = _rows.at(index.row());
+    const bool checked = Qt::Checked == static_cast<Qt::CheckState>(value.toInt());
+    if (_checked.testBit(i) == checked) return true;
+
+    _checked.setBit(i, checked);
+    _checkedCount += checked ? 1 : -1;
+    emit dataChanged(index, index, {Qt::CheckStateRole});
+    return true;
+}
+
+Qt::ItemFlags ActorModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+}
+
+void ActorModel::setScript(const Script::Script& script)
+{
+    // Уникальные актёры и их статистика за один проход
+    QHash<Script::Name, int> index;
+    QVector<Actor> actors;
+    for (const Script::Line::Event& event : script.events.content)
+    {
+        QHash<Script::Name, int>::iterator it = index.find(event.actorName);
+        if (it == index.end())
+        {
+            it = index.insert(event.actorName, actors.size());
+            actors.append({event.actorName.isEmpty() ? Writer::ACTOR_EMPTY : event.actorName.toString(), 0, 0}); // Имя уже без пробелов по краям
+        }
+
+        Actor& actor = actors[it.value()];
+        ++actor.lines;
+        if (event.end > event.start) actor.duration += event.end - event.start;
+    }
+
+    std::sort(actors.begin(), actors.end(), [](const Actor& a, const Actor& b) { return a.name < b.name; });
+
+    beginResetModel();
+    _actors = actors;
+    _checked = QBitArray(_actors.size());
+    _checkedCount = 0;
+    _filter.clear();
+    _rows.resize(_actors.size());
+    for (int i = 0; i < _rows.size(); ++i) _rows[i] = i;
+    endResetModel();
+}
+
+void ActorModel::clear()
+{
+    beginResetModel();
+    _actors.clear();
+    _checked.clear();
+    _checkedCount = 0;
+    _rows.clear();
+    _filter.clear();
+    endResetModel();
+}
+
+void ActorModel::setFilter(const QString& text)
+{
+    const QString filter = text.trimmed();
+    if (filter == _filter) return;
+
+    // Уточнение поиска просматривает только уже найденные строки
+    QVector<int> rows;
+    if (!_filter.isEmpty() && filter.contains(_filter, Qt::CaseInsensitive))
+    {
+        for (const int i : qAsConst(_rows))
+        {
+            if (_actors.at(i).name.contains(filter, Qt::CaseInsensitive)) rows.append(i);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < _actors.size(); ++i)
+        {
+            if (filter.isEmpty() || _actors.at(i).name.contains(filter, Qt::CaseInsensitive)) rows.append(i);
+        }
+    }
+
+    beginResetModel();
+    _rows = rows;
+    _filter = filter;
+    endResetModel();
+}
+
+QStringList ActorModel::checkedActors() const
+{
+    QStringList actors;
+    for (int i = 0; i < _actors.size() && actors.size() < _checkedCount; ++i)
+    {
+        if (_checked.testBit(i)) actors.append(_actors.at(i).name);
+    }
+    return actors;
+}
+
+QStringList ActorModel::allActors() const
+{
+    QStringList actors;
+    actors.reserve(_actors.size());
+    for (const Actor& actor : _actors) actors.append(actor.name);
+    return actors;
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACTORMODEL_H
+#define ACTORMODEL_H
+
+#include "script.h"
+#include <QAbstractListModel>
+#include <QBitArray>
+#include <QStringList>
+#include <QVector>
+
+
+// Список актёров скрипта со статистикой. Строки считаются за один проход по событиям,
+// отметки хранятся битами по индексу актёра и не теряются при поиске.
+class ActorModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ActorModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+    void setScript(const Script::Script& script);
+    void clear();
+
+    // Показывать только актёров, в имени которых есть text
+    void setFilter(const QString& text);
+
+    // Имена в порядке сортировки
+    QStringList checkedActors() const;
+    QStringList allActors() const;
+
+private:
+    struct Actor
+    {
+        QString name;
+        int     lines;    // Строки субтитров, до объединения во фразы
+        quint64 duration; // Суммарное время строк, мс
+    };
+
+    QVector<Actor> _actors;  // По алфавиту
+    QBitArray      _checked; // Отметки по индексу в _actors
+    int            _checkedCount;
+    QVector<int>   _rows;    // Видимые строки: индексы в _actors
+    QString        _filter;
+};
+
+#endif // ACTORMODEL_H
@@ -0,0 +1,340 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "batch.h"
+#include "source.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QTime>
+#include <QtConcurrent>
+#include <cstdio>
+
+
+namespace Batch
+{
+namespace
+{
+// Расширения файлов выгрузки
+const QHash<QString, Writer::ExportFormat> FORMATS = {
+    {"csv",  Writer::EXP_CSV},
+    {"tsv",  Writer::EXP_TSV},
+    {"html", Writer::EXP_HTML},
+    {"pdf",  Writer::EXP_PDF}
+};
+
+struct Settings
+{
+    double                      fps;
+    int                         timeStart;
+    int                         joinInterval;
+    QStringList                 actors;
+    QList<Writer::ExportFormat> formats;
+    QString                     outputDir; // Пусто - рядом с исходным файлом
+};
+
+// Ключи командной строки: одни и те же до создания приложения и в Run
+struct Options
+{
+    const QCommandLineOption batch        {QStringList() << "b" << "batch", "Пакетный режим без окна."};
+    const QCommandLineOption fps          {"fps", "Кадров в секунде (25).", "fps", "25"};
+    const QCommandLineOption timeStart    {QStringList() << "t" << "time-start", "Начало времён, H:mm:ss:кадры или мс (0).", "time", "0"};
+    const QCommandLineOption joinInterval {QStringList() << "i" << "join-interval", "Минимальная пауза между фразами, m:ss или мс (0:05).", "time", "0:05"};
+    const QCommandLineOption actor        {QStringList() << "a" << "actor", "Актёр, можно несколько раз (по умолчанию все).", "name"};
+    const QCommandLineOption format       {QStringList() << "f" << "format", "Форматы через запятую: csv, tsv, html, pdf (csv).", "formats", "csv"};
+    const QCommandLineOption output       {QStringList() << "o" << "output", "Папка для результатов (рядом с исходными).", "dir"};
+    const QCommandLineOption jobs         {QStringList() << "j" << "jobs", "Сколько файлов обрабатывать одновременно.", "n", QString::number(QThread::idealThreadCount())};
+
+    void addTo(QCommandLineParser& parser) const
+    {
+        parser.addOptions({batch, fps, timeStart, joinInterval, actor, format, output, jobs});
+        parser.addPositionalArgument("paths", "Файлы субтитров или папки с ними.", "paths...");
+    }
+};
+
+void PrintError(const QString& message)
+{
+    fprintf(stderr, "%s\n", qPrintable(message));
+}
+
+// Время как в окне ("H:mm:ss:zzz", "m:ss") или в миллисекундах, со знаком
+bool ParseTime(const QString& value, const QString& format, int& result)
+{
+    QString str = value.trimmed();
+    const bool negative = str.startsWith('-') || str.startsWith(QChar(0x2212));
+    if (negative) str.remove(0, 1);
+
+    bool ok;
+    int msec = str.toInt(&ok);
+    if (!ok)
+    {
+        const QTime time = QTime::fromString(str, format);
+        if (!time.isValid()) return false;
+        msec = time.msecsSinceStartOfDay();
+    }
+
+    result = negative ? -msec : msec;
+    return true;
+}
+
+// Файлы субтитров из списка путей, папки просматриваются рекурсивно
+QStringList CollectFiles(const QStringList& paths)
+{
+    QStringList result;
+    QSet<QString> seen; // Один и тот же файл может прийти и сам, и в папке
+    const auto append = [&result, &seen](const QString& fileName)
+    {
+        const QString key = QFileInfo(fileName).absoluteFilePath();
+        if (seen.contains(key)) return;
+        seen.insert(key);
+        result.append(fileName);
+    };
+
+    for (const QString& path : paths)
+    {
+        const QFileInfo info(path);
+        if (info.isDir())
+        {
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+            {
+                it.next();
+                if (Script::FILETYPES.contains(it.fileInfo().suffix(), Qt::CaseInsensitive)) append(it.filePath());
+            }
+        }
+        else
+        {
+            append(path);
+        }
+    }
+    return result;
+}
+
+// Полное имя файла выгрузки в выбранном формате
+QString OutputName(const QString& fileName, const Settings& settings, const Writer::ExportFormat format)
+{
+    const QFileInfo info(fileName);
+    const QDir dir(settings.outputDir.isEmpty() ? info.absolutePath() : settings.outputDir);
+    return QDir::cleanPath(dir.absoluteFilePath(Writer::ExportFileName(info.completeBaseName(), settings.actors, FORMATS.key(format))));
+}
+
+// Одноимённые файлы из разных папок при общей папке результатов затёрли бы друг друга
+bool CheckOutputs(const QStringList& files, const Settings& settings)
+{
+    QHash<QString, QString> sources; // Имя результата без учёта регистра -> исходный файл
+    for (const QString& fileName : files)
+    {
+        for (const Writer::ExportFormat format : settings.formats)
+        {
+            const QString outName = OutputName(fileName, settings, format);
+            const QString key = outName.toCaseFolded();
+            if (sources.contains(key))
+            {
+                PrintError(QString("%1 и %2: одинаковый файл результата %3").arg(sources.value(key), fileName, outName));
+                return false;
+            }
+            sources.insert(key, fileName);
+        }
+    }
+    return true;
+}
+
+// Один файл целиком: чтение, фразы, все форматы
+bool ProcessFile(const QString& fileName, const Settings& settings)
+{
+    Writer::PhraseList phrases;
+    if (!Writer::ReadPhrases(fileName, settings.actors, settings.joinInterval, phrases))
+    {
+        PrintError(QString("%1: ошибка чтения или неизвестный формат").arg(fileName));
+        return false;
+    }
+
+    const QFileInfo info(fileName);
+
+    bool success = true;
+    for (const Writer::ExportFormat format : settings.formats)
+    {
+        const QString outName = OutputName(fileName, settings, format);
+
+        bool saved = false;
+        switch (format)
+        {
+        case Writer::EXP_CSV:
+            saved = Writer::SaveSV(phrases, outName, settings.fps, settings.timeStart, Writer::SEP_CSV);
+            break;
+
+        case Writer::EXP_TSV:
+            saved = Writer::SaveSV(phrases, outName, settings.fps, settings.timeStart, Writer::SEP_TSV);
+            break;
+
+        case Writer::EXP_HTML:
+            saved = Writer::SaveHTML(phrases, outName, settings.fps, settings.timeStart, info.completeBaseName());
+            break;
+
+        case Writer::EXP_PDF:
+            saved = Writer::SavePDF(phrases, outName, settings.fps, settings.timeStart, info.completeBaseName());
+            break;
+        }
+
+        if (!saved)
+        {
+            PrintError(QString("%1: ошибка сохранения файла").arg(outName));
+            success = false;
+        }
+    }
+    return success;
+}
+}
+
+bool IsBatch(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (BATCH_OPTION == QString::fromLocal8Bit(argv[i]) || "-b" == QString::fromLocal8Bit(argv[i])) return true;
+    }
+    return false;
+}
+
+// PDF рисуется шрифтами, для этого нужно приложение с GUI (можно без экрана).
+// Разбор тот же, что в Run, поэтому годятся все формы ключа, в том числе "-fpdf".
+bool NeedsGui(int argc, char *argv[])
+{
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) arguments.append(QString::fromLocal8Bit(argv[i]));
+
+    QCommandLineParser parser;
+    const Options options;
+    options.addTo(parser);
+    if (!parser.parse(arguments)) return false; // Ошибку покажет Run
+
+    for (const QString& name : parser.value(options.format).toLower().split(',', Qt::SkipEmptyParts))
+    {
+        if ("pdf" == name.trimmed()) return true;
+    }
+    return false;
+}
+
+int Run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Пакетное создание монтажных листов");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const Options options;
+    options.addTo(parser);
+
+    if (!parser.parse(arguments))
+    {
+        PrintError(parser.errorText());
+        return EXIT_USAGE;
+    }
+    if (parser.isSet("help"))
+    {
+        fprintf(stdout, "%s", qPrintable(parser.helpText()));
+        return EXIT_OK;
+    }
+    if (parser.isSet("version"))
+    {
+        parser.showVersion();
+    }
+
+    Settings settings;
+    bool ok;
+
+    settings.fps = parser.value(options.fps).toDouble(&ok);
+    if (!ok || settings.fps < 1.0)
+    {
+        PrintError(QString("Неверная частота кадров: %1").arg(parser.value(options.fps)));
+        return EXIT_USAGE;
+    }
+
+    if (!ParseTime(parser.value(options.timeStart), "H:mm:ss:zzz", settings.timeStart))
+    {
+        PrintError(QString("Неверное начало времён: %1").arg(parser.value(options.timeStart)));
+        return EXIT_USAGE;
+    }
+
+    if (!ParseTime(parser.value(options.joinInterval), "m:ss", settings.joinInterval) || settings.joinInterval < 0)
+    {
+        PrintError(QString("Неверная пауза между фразами: %1").arg(parser.value(options.joinInterval)));
+        return EXIT_USAGE;
+    }
+
+    for (const QString& name : parser.value(options.format).toLower().split(',', Qt::SkipEmptyParts))
+    {
+        if (!FORMATS.contains(name.trimmed()))
+        {
+            PrintError(QString("Неизвестный формат: %1").arg(name));
+            return EXIT_USAGE;
+        }
+        const Writer::ExportFormat format = FORMATS.value(name.trimmed());
+        if (!settings.formats.contains(format)) settings.formats.append(format);
+    }
+
+    settings.actors    = parser.values(options.actor);
+    settings.outputDir = parser.value(options.output);
+    if (!settings.outputDir.isEmpty() && !QDir().mkpath(settings.outputDir))
+    {
+        PrintError(QString("Не удалось создать папку: %1").arg(settings.outputDir));
+        return EXIT_USAGE;
+    }
+
+    const int jobs = parser.value(options.jobs).toInt(&ok);
+    if (!ok || jobs < 1)
+    {
+        PrintError(QString("Неверное число потоков: %1").arg(parser.value(options.jobs)));
+        return EXIT_USAGE;
+    }
+
+    const QStringList files = CollectFiles(parser.positionalArguments());
+    if (files.isEmpty())
+    {
+        PrintError("Не указаны файлы субтитров");
+        return EXIT_USAGE;
+    }
+    if (!CheckOutputs(files, settings)) return EXIT_USAGE;
+
+    // Файлы обрабатываются на отдельном ограниченном пуле; внутри файла работает общий
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+
+    QList< QFuture<bool> > results;
+    for (const QString& fileName : files)
+    {
+        results.append(QtConcurrent::run(&pool, [fileName, settings]() { return ProcessFile(fileName, settings); }));
+    }
+
+    int failed = 0;
+    for (QFuture<bool>& result : results)
+    {
+        if (!result.result()) ++failed;
+    }
+
+    if (failed > 0)
+    {
+        PrintError(QString("Обработано с ошибками: %1 из %2").arg(failed).arg(files.size()));
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+}
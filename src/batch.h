@@ -0,0 +1,41 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "writer.h"
+#include <QStringList>
+
+
+namespace Batch
+{
+// Коды завершения
+enum ExitCode {EXIT_OK = 0, EXIT_FAILED = 1, EXIT_USAGE = 2};
+
+// Ключ, по которому запускается пакетный режим вместо окна
+const QString BATCH_OPTION = "--batch";
+
+bool IsBatch(int argc, char *argv[]);
+bool NeedsGui(int argc, char *argv[]);
+
+// Разбор командной строки и обработка всех файлов, возвращает код завершения
+int Run(const QStringList& arguments);
+}
+
+#endif // BATCH_H
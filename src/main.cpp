@@ -17,15 +17,36 @@
  */
 
 #include "mainwindow.h"
+#include "batch.h"
 #include <QApplication>
+#include <QScopedPointer>
 
 
 int main(int argc, char *argv[])
 {
+    QCoreApplication::setApplicationName("DSCreator");
+    QCoreApplication::setApplicationVersion("2.0");
+    QCoreApplication::setOrganizationName("Unlimited Web Works");
+
+    // Пакетный режим: без окна, результат - код завершения
+    if (Batch::IsBatch(argc, argv))
+    {
+        QScopedPointer<QCoreApplication> app;
+        if (Batch::NeedsGui(argc, argv))
+        {
+            // Для PDF нужны шрифты, но не экран
+            if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+            app.reset(new QGuiApplication(argc, argv));
+        }
+        else
+        {
+            app.reset(new QCoreApplication(argc, argv));
+        }
+
+        return Batch::Run(app->arguments());
+    }
+
     QApplication a(argc, argv);
-    a.setApplicationName("DSCreator");
-    a.setApplicationVersion("2.0");
-    a.setOrganizationName("Unlimited Web Works");
     a.setWindowIcon(QIcon(":/main.ico"));
 
     MainWindow w;
@@ -19,29 +19,107 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "writer.h"
+#include "source.h"
 #include <QStyle>
 #include <QScreen>
 #include <QDragEnterEvent>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QDir>
+#include <QInputDialog>
 #include <QMimeData>
 #include <QUrl>
+#include <QHeaderView>
+#include <QtConcurrent>
 
 QString UrlToPath(const QUrl &url);
 
-const QStringList FILETYPES = {"ass", "ssa", "srt"};
-const QString FILETYPES_FILTER  = QString("Субтитры (*.%1)").arg(FILETYPES.join(" *.")),
+const QString FILETYPES_FILTER  = QString("Субтитры (*.%1)").arg(Script::FILETYPES.join(" *.")),
               DEFAULT_DIR_KEY   = "DefaultDir",
               FPS_KEY           = "FPS",
               TIME_START_KEY    = "TimeStart",
               JOIN_INTERVAL_KEY = "JoinInterval";
 
+// Сколько существующих файлов перечислять в вопросе о перезаписи
+const int MAX_SHOWN = 10;
+
+// Частота обновления индикаторов хода, мс
+const int PROGRESS_INTERVAL = 100;
+
+// Предпросмотр пересобирается, когда выбор не меняется столько мс
+const int PREVIEW_DELAY = 300;
+
+// Ход открытия файла: пишет поток разбора, читает окно по таймеру
+class LoadProgress : public Script::ParseProgress
+{
+public:
+    LoadProgress() :
+        _done(0),
+        _total(0),
+        _cancelled(0)
+    {}
+
+    bool update(const qint64 done, const qint64 total) override
+    {
+        _done.store(done);
+        _total.store(total);
+        return !this->isCancelled();
+    }
+
+    void cancel() { _cancelled.store(1); }
+    bool isCancelled() const { return 0 != _cancelled.load(); }
+
+    // Пройденная доля в тысячных
+    int permille() const
+    {
+        const qint64 total = _total.load();
+        return total > 0 ? static_cast<int>(_done.load() * 1000 / total) : 0;
+    }
+
+private:
+    QAtomicInteger<qint64> _done;
+    QAtomicInteger<qint64> _total;
+    QAtomicInt             _cancelled;
+};
+
+// Ход выгрузки файла: пишет поток записи, читает окно по таймеру
+class ExportProgress : public Writer::SaveProgress
+{
+public:
+    ExportProgress() :
+        _permille(0)
+    {}
+
+    void update(const int done, const int total) override
+    {
+        _permille.store(total > 0 ? static_cast<int>(static_cast<qint64>(done) * 1000 / total) : 1000);
+    }
+
+    // Пройденная доля в тысячных
+    int permille() const { return _permille.load(); }
+
+private:
+    QAtomicInt _permille;
+};
+
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    _phrases(new Writer::PhraseCache),
+    _previewPending(false)
 {
     ui->setupUi(this);
+    ui->lsActors->setModel(&_actors);
+    ui->tvPreview->setModel(&_preview);
+    ui->tvPreview->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tvPreview->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    connect(&_actors, &ActorModel::dataChanged, this, &MainWindow::updatePreview);
+
+    _previewTimer.setSingleShot(true);
+    _previewTimer.setInterval(PREVIEW_DELAY);
+    connect(&_previewTimer, &QTimer::timeout, this, &MainWindow::startPreview);
+    connect(&_previewBuilder, &QFutureWatcher<Writer::PhraseList>::finished, this, &MainWindow::previewFinished);
 
     const int timeStart = _settings.value(TIME_START_KEY, this->getTimeStart()).toInt();
 
@@ -50,11 +128,29 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->edTimeStart->setTime(QTime::fromMSecsSinceStartOfDay(abs(timeStart)));
     ui->edJoinInterval->setTime(QTime::fromMSecsSinceStartOfDay(_settings.value(JOIN_INTERVAL_KEY, ui->edJoinInterval->time().msecsSinceStartOfDay()).toInt()));
 
+    ui->pbLoading->hide();
+    ui->btCancelLoading->hide();
+    _loadTimer.setInterval(PROGRESS_INTERVAL);
+    connect(&_loadTimer, &QTimer::timeout, this, &MainWindow::updateLoadProgress);
+    connect(&_loader, &QFutureWatcher<LoadResult>::finished, this, &MainWindow::loadFinished);
+
+    ui->lsJobs->hide();
+    ui->btClearJobs->hide();
+    _exportTimer.setInterval(PROGRESS_INTERVAL);
+    connect(&_exportTimer, &QTimer::timeout, this, &MainWindow::updateExports);
+
+    this->updatePreviewTiming();
+
     this->setGeometry(QStyle::alignedRect(Qt::LeftToRight, Qt::AlignCenter, this->size(), qApp->primaryScreen()->availableGeometry()));
 }
 
 MainWindow::~MainWindow()
 {
+    this->cancelLoading();
+
+    // Начатые файлы дописываются до конца
+    _exportPool.waitForDone();
+
     _settings.setValue(FPS_KEY, ui->edFPS->value());
     _settings.setValue(TIME_START_KEY, this->getTimeStart());
     _settings.setValue(JOIN_INTERVAL_KEY, ui->edJoinInterval->time().msecsSinceStartOfDay());
@@ -107,16 +203,7 @@ void MainWindow::on_btSaveCSV_clicked()
     const QString fileName   = this->getSaveFileName(actors, "csv");
     if (fileName.isEmpty()) return;
 
-    if (!Writer::SaveSV(_script,
-                        fileName,
-                        actors,
-                        ui->edFPS->value(),
-                        this->getTimeStart(),
-                        ui->edJoinInterval->time().msecsSinceStartOfDay(),
-                        Writer::SEP_CSV))
-    {
-        QMessageBox::critical(this, "Ошибка", "Ошибка сохранения файла");
-    }
+    this->startExport({{Writer::EXP_CSV, fileName, this->getPhrases(actors), _fileInfo.completeBaseName()}});
 }
 
 void MainWindow::on_btSaveTSV_clicked()
@@ -125,16 +212,7 @@ void MainWindow::on_btSaveTSV_clicked()
     const QString fileName   = this->getSaveFileName(actors, "tsv");
     if (fileName.isEmpty()) return;
 
-    if (!Writer::SaveSV(_script,
-                        fileName,
-                        actors,
-                        ui->edFPS->value(),
-                        this->getTimeStart(),
-                        ui->edJoinInterval->time().msecsSinceStartOfDay(),
-                        Writer::SEP_TSV))
-    {
-        QMessageBox::critical(this, "Ошибка", "Ошибка сохранения файла");
-    }
+    this->startExport({{Writer::EXP_TSV, fileName, this->getPhrases(actors), _fileInfo.completeBaseName()}});
 }
 
 void MainWindow::on_btSaveHTML_clicked()
@@ -143,18 +221,260 @@ void MainWindow::on_btSaveHTML_clicked()
     const QString fileName   = this->getSaveFileName(actors, "html");
     if (fileName.isEmpty()) return;
 
-    if (!Writer::SaveHTML(_script,
-                          fileName,
-                          actors,
-                          ui->edFPS->value(),
-                          this->getTimeStart(),
-                          ui->edJoinInterval->time().msecsSinceStartOfDay(),
-                          _fileInfo.completeBaseName()))
+    this->startExport({{Writer::EXP_HTML, fileName, this->getPhrases(actors), _fileInfo.completeBaseName()}});
+}
+
+void MainWindow::on_btSavePDF_clicked()
+{
+    const QStringList actors = this->getCheckedActors();
+    const QString fileName   = this->getSaveFileName(actors, "pdf");
+    if (fileName.isEmpty()) return;
+
+    this->startExport({{Writer::EXP_PDF, fileName, this->getPhrases(actors), _fileInfo.completeBaseName()}});
+}
+
+void MainWindow::on_btSaveAll_clicked()
+{
+    const QStringList actors = this->getCheckedActors();
+    const QString dirName    = QFileDialog::getExistingDirectory(this,
+                                                                 "Выберите папку",
+                                                                 _fileInfo.absolutePath());
+    if (dirName.isEmpty()) return;
+
+    // Имена как в диалоге сохранения, все файлы в выбранной папке
+    const QDir dir(dirName);
+    const Writer::PhraseList& phrases = this->getPhrases(actors);
+    const QString title = _fileInfo.completeBaseName();
+    const Writer::ExportJobList jobs = {
+        {Writer::EXP_CSV,  dir.filePath(this->getDefaultFileName(actors, "csv")),  phrases, title},
+        {Writer::EXP_TSV,  dir.filePath(this->getDefaultFileName(actors, "tsv")),  phrases, title},
+        {Writer::EXP_HTML, dir.filePath(this->getDefaultFileName(actors, "html")), phrases, title},
+        {Writer::EXP_PDF,  dir.filePath(this->getDefaultFileName(actors, "pdf")),  phrases, title}
+    };
+    if (!this->confirmOverwrite(jobs)) return;
+
+    this->startExport(jobs);
+}
+
+// Отдельный файл на каждого актёра: фразы собираются один раз и раскладываются по актёрам
+void MainWindow::on_btSaveSplit_clicked()
+{
+    QStringList actors = this->getCheckedActors();
+    if (actors.isEmpty()) actors = this->getAllActors();
+
+    const QStringList formats = {"CSV", "TSV", "HTML", "PDF", "Все"};
+    bool ok;
+    const QString format = QInputDialog::getItem(this, "Файл на каждого актёра", "Формат", formats, 0, false, &ok);
+    if (!ok) return;
+
+    const QString dirName = QFileDialog::getExistingDirectory(this,
+                                                              "Выберите папку",
+                                                              _fileInfo.absolutePath());
+    if (dirName.isEmpty()) return;
+
+    QMap<Writer::ExportFormat, QString> suffixes;
+    if ("CSV"  == format || "Все" == format) suffixes.insert(Writer::EXP_CSV,  "csv");
+    if ("TSV"  == format || "Все" == format) suffixes.insert(Writer::EXP_TSV,  "tsv");
+    if ("HTML" == format || "Все" == format) suffixes.insert(Writer::EXP_HTML, "html");
+    if ("PDF"  == format || "Все" == format) suffixes.insert(Writer::EXP_PDF,  "pdf");
+
+    const QDir dir(dirName);
+    const QHash<QString, Writer::PhraseList> byActor = Writer::SplitByActor(this->getPhrases(actors));
+
+    // Варианты имени в разном регистре SplitByActor уже объединил: файл на них один,
+    // иначе в папке без учёта регистра два потока писали бы в один и тот же файл
+    QStringList groups;
+    QSet<QString> seen;
+    for (const QString& actor : qAsConst(actors))
     {
-        QMessageBox::critical(this, "Ошибка", "Ошибка сохранения файла");
+        const QString key = actor.toCaseFolded();
+        if (seen.contains(key)) continue;
+        seen.insert(key);
+        groups.append(actor);
+    }
+
+    Writer::ExportJobList jobs;
+    for (const QString& actor : qAsConst(groups))
+    {
+        const Writer::PhraseList phrases = byActor.value(actor.toCaseFolded());
+        for (QMap<Writer::ExportFormat, QString>::const_iterator it = suffixes.constBegin(); it != suffixes.constEnd(); ++it)
+        {
+            jobs.append({it.key(),
+                         dir.filePath(this->getDefaultFileName(QStringList(actor), it.value())),
+                         phrases,
+                         _fileInfo.completeBaseName()});
+        }
+    }
+    if (!this->confirmOverwrite(jobs)) return;
+
+    this->startExport(jobs);
+}
+
+void MainWindow::on_btCancelLoading_clicked()
+{
+    // Поток заметит отмену сам, окно дождётся loadFinished
+    ui->btCancelLoading->setEnabled(false);
+    if (!_loadProgress.isNull()) _loadProgress->cancel();
+}
+
+void MainWindow::updateLoadProgress()
+{
+    if (!_loadProgress.isNull()) ui->pbLoading->setValue(_loadProgress->permille());
+}
+
+void MainWindow::loadFinished()
+{
+    _loadTimer.stop();
+    ui->pbLoading->hide();
+    ui->btCancelLoading->hide();
+
+    // Отменённый разбор просто забываем
+    if (_loadProgress.isNull() || _loadProgress->isCancelled()) return;
+
+    const LoadResult result = _loader.result();
+    if (!result.error.isEmpty())
+    {
+        QMessageBox::critical(this, "Ошибка", result.error);
+        return;
+    }
+
+    // Готовый скрипт подменяется целиком и только здесь, в потоке окна
+    _script = result.script;
+    _phrases->setScript(_script);
+
+    if (_script.events.content.isEmpty())
+    {
+        QMessageBox::warning(this, "Сообщение", "В субтитрах нет фраз");
+    }
+    else
+    {
+        this->updateActors();
+        this->startPreview();
+        this->setExportEnabled(true);
     }
 }
 
+void MainWindow::on_btClearJobs_clicked()
+{
+    for (QList<ExportEntry>::iterator it = _exports.begin(); it != _exports.end();)
+    {
+        if (it->finished)
+        {
+            delete it->item;
+            it = _exports.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (_exports.isEmpty())
+    {
+        ui->lsJobs->hide();
+        ui->btClearJobs->hide();
+    }
+}
+
+void MainWindow::on_edActorFilter_textChanged(const QString& text)
+{
+    _actors.setFilter(text);
+}
+
+// Время в предпросмотре переводится заново только для видимых строк
+void MainWindow::on_edFPS_valueChanged(double)
+{
+    this->updatePreviewTiming();
+}
+
+void MainWindow::on_edTimeStart_timeChanged(const QTime&)
+{
+    this->updatePreviewTiming();
+}
+
+void MainWindow::on_cbNegativeTimeStart_toggled(bool)
+{
+    this->updatePreviewTiming();
+}
+
+void MainWindow::on_edJoinInterval_timeChanged(const QTime&)
+{
+    this->updatePreview();
+}
+
+void MainWindow::updatePreviewTiming()
+{
+    _preview.setTiming(ui->edFPS->value(), this->getTimeStart());
+}
+
+// Отметки и интервал меняются часто: сборка начнётся, когда они успокоятся
+void MainWindow::updatePreview()
+{
+    _previewTimer.start();
+}
+
+// Склейка по кэшу очищенного текста идёт в пуле потоков, окно не ждёт
+void MainWindow::startPreview()
+{
+    if (_previewBuilder.isRunning())
+    {
+        _previewPending = true;
+        return;
+    }
+
+    const QSharedPointer<Writer::PhraseCache> cache = _phrases;
+    const QStringList actors = this->getCheckedActors();
+    const int joinInterval   = ui->edJoinInterval->time().msecsSinceStartOfDay();
+    _previewBuilder.setFuture(QtConcurrent::run([cache, actors, joinInterval]() { return cache->phrases(actors, joinInterval); }));
+}
+
+void MainWindow::previewFinished()
+{
+    // Пока собиралось, выбор сменился: устаревшее не показываем, собираем заново
+    if (_previewPending)
+    {
+        _previewPending = false;
+        this->startPreview();
+        return;
+    }
+
+    // Сборка для прежнего файла
+    if (_previewBuilder.isCanceled()) return;
+
+    _preview.setPhrases(_previewBuilder.result());
+}
+
+void MainWindow::updateExports()
+{
+    bool running = false;
+    for (ExportEntry& entry : _exports)
+    {
+        if (entry.finished) continue;
+
+        const QString name = QFileInfo(entry.fileName).fileName();
+        if (entry.future.isFinished())
+        {
+            entry.finished = true;
+            if (entry.future.result())
+            {
+                entry.item->setText(QString("✔ %1").arg(name));
+            }
+            else
+            {
+                entry.item->setText(QString("✖ %1: ошибка сохранения файла").arg(name));
+                entry.item->setForeground(Qt::red);
+            }
+        }
+        else
+        {
+            running = true;
+            entry.item->setText(QString("%1 — %2%").arg(name).arg(entry.progress->permille() / 10));
+        }
+    }
+
+    if (!running) _exportTimer.stop();
+}
+
 /*void MainWindow::on_lsActors_itemClicked(QListWidgetItem* item)
 {
     if (nullptr == item) return;
@@ -169,7 +489,7 @@ QString UrlToPath(const QUrl &url)
 {
     if (url.isLocalFile()) {
         const QString path = url.toLocalFile();
-        if (FILETYPES.contains(QFileInfo(path).suffix(), Qt::CaseInsensitive)) {
+        if (Script::FILETYPES.contains(QFileInfo(path).suffix(), Qt::CaseInsensitive)) {
             return path;
         }
     }
@@ -178,45 +498,36 @@ QString UrlToPath(const QUrl &url)
 
 void MainWindow::updateActors()
 {
-    ui->lsActors->clear();
+    ui->edActorFilter->clear();
+    _actors.setScript(_script);
+}
 
-    QSet<QString> uniqueActors;
-    for (const Script::Line::Event* const event : qAsConst(_script.events.content))
-    {
-        uniqueActors.insert(event->actorName.isEmpty() ? Writer::ACTOR_EMPTY : event->actorName); // Already trimmed
-    }
+QStringList MainWindow::getCheckedActors() const
+{
+    return _actors.checkedActors();
+}
 
-    QStringList actors = uniqueActors.values();
-    actors.sort();
+// Фразы пересобираются, только если сменились актёры или интервал объединения
+Writer::PhraseList MainWindow::getPhrases(const QStringList& actors)
+{
+    return _phrases->phrases(actors, ui->edJoinInterval->time().msecsSinceStartOfDay());
+}
 
-    for (const QString& actor : qAsConst(actors))
-    {
-        QListWidgetItem* const item = new QListWidgetItem(actor, ui->lsActors);
-//        item->setFlags(item->flags() & (~Qt::ItemIsUserCheckable));
-        item->setCheckState(Qt::Unchecked);
-    }
+QStringList MainWindow::getAllActors() const
+{
+    return _actors.allActors();
 }
 
-QStringList MainWindow::getCheckedActors() const
+QString MainWindow::getDefaultFileName(const QStringList& actors, const QString& suffix) const
 {
-    QStringList actors;
-    for (int i = 0; i < ui->lsActors->count(); ++i)
-    {
-        const QListWidgetItem* const item = ui->lsActors->item(i);
-        if (Qt::Checked == item->checkState()) actors.append(item->text());
-    }
-    return actors;
+    return Writer::ExportFileName(_fileInfo.completeBaseName(), actors, suffix);
 }
 
 QString MainWindow::getSaveFileName(const QStringList& actors, const QString& suffix)
 {
-    QString fileName = _fileInfo.completeBaseName();
-    if (!actors.isEmpty()) fileName.append(QString(" (%1)").arg(actors.join(',')));
-    fileName.append(QString(".%1").arg(suffix));
-
     return QFileDialog::getSaveFileName(this,
                                         "Выберите файл",
-                                        _fileInfo.dir().filePath(fileName),
+                                        _fileInfo.dir().filePath(this->getDefaultFileName(actors, suffix)),
                                         QString("%1 (*.%2)").arg(suffix.toUpper()).arg(suffix));
 }
 
@@ -227,64 +538,146 @@ int MainWindow::getTimeStart() const
     return ui->cbNegativeTimeStart->isChecked() ? -timeStart : timeStart;
 }
 
+void MainWindow::setExportEnabled(const bool enabled)
+{
+    ui->edActorFilter->setEnabled(enabled);
+    ui->lsActors->setEnabled(enabled);
+    ui->btSaveCSV->setEnabled(enabled);
+    ui->btSaveTSV->setEnabled(enabled);
+    ui->btSaveHTML->setEnabled(enabled);
+    ui->btSavePDF->setEnabled(enabled);
+    ui->btSaveAll->setEnabled(enabled);
+    ui->btSaveSplit->setEnabled(enabled);
+}
+
+// Папку выбирают без диалога сохранения, поэтому о перезаписи спрашиваем сами, один раз на все файлы
+bool MainWindow::confirmOverwrite(const Writer::ExportJobList& jobs)
+{
+    QStringList existing;
+    for (const Writer::ExportJob& job : jobs)
+    {
+        if (QFileInfo::exists(job.fileName)) existing.append(QFileInfo(job.fileName).fileName());
+    }
+    if (existing.isEmpty()) return true;
+
+    QString list = QStringList(existing.mid(0, MAX_SHOWN)).join("\n");
+    if (existing.size() > MAX_SHOWN) list += QString("\n… и ещё %1").arg(existing.size() - MAX_SHOWN);
+
+    return QMessageBox::Yes == QMessageBox::question(this,
+                                                     "Подтверждение",
+                                                     QString("Файлы уже существуют (%1):\n%2\n\nПерезаписать?").arg(existing.size()).arg(list),
+                                                     QMessageBox::Yes | QMessageBox::No,
+                                                     QMessageBox::No);
+}
+
+// Выгрузки ставятся в очередь и пишутся в фоне, ход и ошибки видны в списке заданий.
+// Задание держит свою копию фраз, поэтому можно сразу открывать следующий файл.
+void MainWindow::startExport(const Writer::ExportJobList& jobs)
+{
+    const double fps    = ui->edFPS->value();
+    const int timeStart = this->getTimeStart();
+    for (const Writer::ExportJob& job : jobs)
+    {
+        ExportEntry entry;
+        entry.fileName = job.fileName;
+        entry.progress.reset(new ExportProgress);
+        entry.item     = new QListWidgetItem(QFileInfo(job.fileName).fileName(), ui->lsJobs);
+        entry.item->setToolTip(job.fileName);
+        entry.finished = false;
+
+        const QSharedPointer<ExportProgress> progress = entry.progress;
+        entry.future = QtConcurrent::run(&_exportPool, [job, fps, timeStart, progress]() { return Writer::Save(job, fps, timeStart, progress.data()); });
+        _exports.append(entry);
+    }
+
+    ui->lsJobs->show();
+    ui->btClearJobs->show();
+    ui->lsJobs->scrollToBottom();
+    _exportTimer.start();
+}
+
+// Отмена открытия с ожиданием потока, только при закрытии окна: разбор замечает
+// отмену не позже чем через PROGRESS_STEP байт, в том числе в параллельных кусках
+void MainWindow::cancelLoading()
+{
+    if (!_loader.isRunning()) return;
+
+    _loadProgress->cancel();
+    _loader.waitForFinished();
+}
+
 void MainWindow::openFile(const QString &fileName)
 {
+    // Предыдущее открытие больше не нужно. Не ждём: поток сам держит свой ход
+    // и доработает в фоне, а наблюдатель переключится на новый разбор
+    if (!_loadProgress.isNull()) _loadProgress->cancel();
+
     // Очистка
-    ui->lsActors->setEnabled(false);
-    ui->btSaveCSV->setEnabled(false);
-    ui->btSaveTSV->setEnabled(false);
-    ui->btSaveHTML->setEnabled(false);
+    this->setExportEnabled(false);
+    ui->edActorFilter->clear();
+    _actors.clear();
     _fileInfo.setFile(fileName);
     _script.clear();
+    _preview.clear();
+
+    // Сборка предпросмотра прежнего файла доработает в фоне со своим кэшем, её результат не нужен
+    _previewTimer.stop();
+    _previewPending = false;
+    _previewBuilder.cancel();
+    _phrases.reset(new Writer::PhraseCache);
+
+    // Разбор в фоне, окно только показывает ход и может его отменить
+    _loadProgress.reset(new LoadProgress);
+    const QSharedPointer<LoadProgress> progress = _loadProgress;
+    _loader.setFuture(QtConcurrent::run([fileName, progress]() { return MainWindow::loadScript(fileName, progress); }));
+
+    ui->pbLoading->setValue(0);
+    ui->pbLoading->show();
+    ui->btCancelLoading->setEnabled(true);
+    ui->btCancelLoading->show();
+    _loadTimer.start();
+}
 
-    // Чтение файла
-    QFile fin(fileName);
-    if ( !fin.open(QFile::ReadOnly | QFile::Text) )
+// Выполняется в пуле потоков: окна не касается, всё складывает в результат
+MainWindow::LoadResult MainWindow::loadScript(const QString& fileName, const QSharedPointer<LoadProgress>& progress)
+{
+    LoadResult result;
+
+    // Чтение файла: формат и кодировка определяются по тому же буферу, что потом разбирается
+    Script::Source source;
+    if ( !source.open(fileName) )
     {
-        QMessageBox::critical(this, "Ошибка", "Ошибка открытия файла");
-        return;
+        result.error = "Ошибка открытия файла";
+        return result;
     }
 
-    QTextStream in(&fin);
-    switch (Script::DetectFormat(in))
+    // Скрипт только для чтения: нужны лишь поля фраз
+    Script::ParseOptions options;
+    options.fields      = Writer::PHRASE_FIELDS;
+    options.attachments = false;
+    options.progress    = progress.data();
+
+    switch (source.format())
     {
     case Script::SCR_SSA:
     case Script::SCR_ASS:
-        if ( !Script::ParseSSA(in, _script) )
+        if ( !Script::ParseSSA(source.data(), source.size(), result.script, options) )
         {
-            QMessageBox::critical(this, "Ошибка", "Файл не соответствует формату SSA/ASS");
-            fin.close();
-            return;
+            result.error = "Файл не соответствует формату SSA/ASS";
         }
         break;
 
     case Script::SCR_SRT:
-        if ( !Script::ParseSRT(in, _script) )
+        if ( !Script::ParseSRT(source.data(), source.size(), result.script, options.progress) )
         {
-            QMessageBox::critical(this, "Ошибка", "Файл не соответствует формату SRT");
-            fin.close();
-            return;
+            result.error = "Файл не соответствует формату SRT";
         }
         break;
 
     default:
-        QMessageBox::critical(this, "Ошибка", "Неизвестный формат файла");
-        fin.close();
-        return;
+        result.error = "Неизвестный формат файла";
+        break;
     }
-    fin.close();
 
-    if (_script.events.content.isEmpty())
-    {
-        ui->lsActors->clear();
-        QMessageBox::warning(this, "Сообщение", "В субтитрах нет фраз");
-    }
-    else
-    {
-        this->updateActors();
-        ui->lsActors->setEnabled(true);
-        ui->btSaveCSV->setEnabled(true);
-        ui->btSaveTSV->setEnabled(true);
-        ui->btSaveHTML->setEnabled(true);
-    }
+    return result;
 }
@@ -20,16 +20,26 @@
 #define MAINWINDOW_H
 
 #include "script.h"
+#include "writer.h"
+#include "actormodel.h"
+#include "phrasemodel.h"
 #include <QMainWindow>
 #include <QSettings>
 #include <QFileInfo>
 #include <QListWidgetItem>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QTimer>
 
 
 namespace Ui {
 class MainWindow;
 }
 
+class LoadProgress;
+class ExportProgress;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -43,21 +53,81 @@ private slots:
     void on_btSaveCSV_clicked();
     void on_btSaveTSV_clicked();
     void on_btSaveHTML_clicked();
+    void on_btSavePDF_clicked();
+    void on_btSaveAll_clicked();
+    void on_btSaveSplit_clicked();
+    void on_btCancelLoading_clicked();
+    void on_btClearJobs_clicked();
+    void on_edActorFilter_textChanged(const QString& text);
+    void on_edFPS_valueChanged(double);
+    void on_edTimeStart_timeChanged(const QTime&);
+    void on_cbNegativeTimeStart_toggled(bool);
+    void on_edJoinInterval_timeChanged(const QTime&);
+    void updatePreview();
+    void startPreview();
+    void previewFinished();
 //    void on_lsActors_itemClicked(QListWidgetItem* item);
+    void loadFinished();
+    void updateLoadProgress();
+    void updateExports();
 
 private:
+    // Результат разбора в фоне
+    struct LoadResult
+    {
+        Script::Script script;
+        QString error;
+    };
+
+    // Выгрузка одного файла в фоне
+    struct ExportEntry
+    {
+        QString fileName;
+        QFuture<bool> future;
+        QSharedPointer<ExportProgress> progress;
+        QListWidgetItem* item;
+        bool finished;
+    };
+
     Ui::MainWindow *ui;
     QSettings _settings;
     QFileInfo _fileInfo;
     Script::Script _script;
+    ActorModel _actors;
+    QSharedPointer<Writer::PhraseCache> _phrases; // Свой на каждый файл: старая сборка доработает со старым
+    PhraseModel _preview;
+
+    // Сборка предпросмотра в фоне, частые изменения откладываются
+    QFutureWatcher<Writer::PhraseList> _previewBuilder;
+    QTimer _previewTimer;
+    bool _previewPending; // Выбор сменился во время сборки
+
+    // Открытие файла в фоне
+    QFutureWatcher<LoadResult> _loader;
+    QSharedPointer<LoadProgress> _loadProgress;
+    QTimer _loadTimer;
+
+    // Очередь выгрузок: свой пул, чтобы запись не мешала открытию следующего файла
+    QThreadPool _exportPool;
+    QList<ExportEntry> _exports;
+    QTimer _exportTimer;
 
     void dragEnterEvent(QDragEnterEvent *event);
     void dropEvent(QDropEvent *event);
     void updateActors();
     QStringList getCheckedActors() const;
+    QStringList getAllActors() const;
+    Writer::PhraseList getPhrases(const QStringList& actors);
+    QString getDefaultFileName(const QStringList& actors, const QString& suffix) const;
     QString getSaveFileName(const QStringList& actors, const QString& suffix);
     int getTimeStart() const;
+    void setExportEnabled(const bool enabled);
+    void updatePreviewTiming();
+    bool confirmOverwrite(const Writer::ExportJobList& jobs);
+    void startExport(const Writer::ExportJobList& jobs);
+    void cancelLoading();
     void openFile(const QString &fileName);
+    static LoadResult loadScript(const QString& fileName, const QSharedPointer<LoadProgress>& progress);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,171 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "names.h"
+
+
+namespace Script
+{
+struct Name::Entry
+{
+    QString    str;
+    uint       id;
+    uint       hash;
+    NameTable* table; // У пустого имени нет таблицы
+};
+
+namespace
+{
+// Пустое имя общее для всех таблиц и никогда не освобождается
+const Name::Entry EMPTY_ENTRY = {QString(), 0, qHash(QString()), nullptr};
+}
+
+Name::Name() :
+    _entry(&EMPTY_ENTRY)
+{}
+
+Name::Name(const Entry* entry) :
+    _entry(entry)
+{
+    this->acquire();
+}
+
+Name::Name(const QString& str) :
+    _entry(&EMPTY_ENTRY)
+{
+    if (str.isEmpty()) return;
+
+    const QByteArray utf8 = str.toUtf8();
+    *this = (new NameTable)->intern(utf8.constData(), utf8.size());
+}
+
+Name::Name(const Name& other) :
+    _entry(other._entry)
+{
+    this->acquire();
+}
+
+Name::Name(Name&& other) noexcept :
+    _entry(other._entry)
+{
+    other._entry = &EMPTY_ENTRY;
+}
+
+Name::~Name()
+{
+    this->release();
+}
+
+Name& Name::operator=(const Name& other)
+{
+    if (_entry != other._entry)
+    {
+        other.acquire();
+        this->release();
+        _entry = other._entry;
+    }
+    return *this;
+}
+
+// Старое имя уходит в other и освобождается вместе с ним
+Name& Name::operator=(Name&& other) noexcept
+{
+    qSwap(_entry, other._entry);
+    return *this;
+}
+
+void Name::acquire() const
+{
+    if (nullptr != _entry->table) _entry->table->ref.ref();
+}
+
+void Name::release() const
+{
+    if (nullptr != _entry->table && !_entry->table->ref.deref()) delete _entry->table;
+}
+
+const QString& Name::toString() const
+{
+    return _entry->str;
+}
+
+uint Name::id() const
+{
+    return _entry->id;
+}
+
+uint Name::hash() const
+{
+    return _entry->hash;
+}
+
+bool Name::operator==(const Name& other) const
+{
+    if (_entry == other._entry) return true;
+
+    // В одной таблице строки не повторяются
+    return _entry->table != other._entry->table &&
+           _entry->hash == other._entry->hash &&
+           _entry->str == other._entry->str;
+}
+
+NameTable::NameTable()
+{}
+
+NameTable::~NameTable()
+{
+    qDeleteAll(_entries);
+}
+
+Name NameTable::intern(const char* data, const int size)
+{
+    if (size <= 0) return Name();
+
+    const QByteArray key = QByteArray::fromRawData(data, size);
+    {
+        QReadLocker locker(&_lock);
+        const Name::Entry* const entry = _hash.value(key, nullptr);
+        if (nullptr != entry) return Name(entry);
+    }
+
+    QWriteLocker locker(&_lock);
+    Name::Entry*& entry = _hash[QByteArray(data, size)];
+    if (nullptr == entry)
+    {
+        const QString str = QString::fromUtf8(data, size);
+        entry = new Name::Entry{str, static_cast<uint>(_entries.size()) + 1u, qHash(str), this};
+        _entries.append(entry);
+    }
+    return Name(entry);
+}
+
+NameCache::NameCache() :
+    _table(new NameTable)
+{}
+
+Name NameCache::get(const Span& str)
+{
+    const QByteArray key = QByteArray::fromRawData(str.data(), str.size());
+    const auto it = _names.constFind(key);
+    if (it != _names.constEnd()) return it.value();
+
+    const Name name = _table->intern(str.data(), str.size());
+    _names.insert(QByteArray(str.data(), str.size()), name);
+    return name;
+}
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef NAMES_H
+#define NAMES_H
+
+#include "tokenizer.h"
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSharedData>
+#include <QString>
+#include <QVector>
+
+
+namespace Script
+{
+class NameTable;
+
+// Интернированное имя (стиль, актёр). Строка хранится один раз в таблице своего разбора,
+// и таблица живёт, пока на неё ссылается хоть одно имя. Имена одной таблицы сравниваются
+// по указателю, разных таблиц - по строке.
+class Name
+{
+public:
+    Name();
+    explicit Name(const QString& str); // Отдельная таблица из одного имени
+    Name(const Name& other);
+    Name(Name&& other) noexcept; // Без обращения к счётчику таблицы
+    ~Name();
+
+    Name& operator=(const Name& other);
+    Name& operator=(Name&& other) noexcept;
+
+    const QString& toString() const;
+    uint id() const; // Номер в таблице, у пустого имени 0
+    uint hash() const;
+    bool isEmpty() const { return 0 == this->id(); }
+
+    bool operator==(const Name& other) const;
+    bool operator!=(const Name& other) const { return !(*this == other); }
+
+    struct Entry;
+
+private:
+    const Entry* _entry;
+
+    explicit Name(const Entry* entry);
+    void acquire() const;
+    void release() const;
+
+    friend class NameTable;
+};
+
+inline uint qHash(const Name& name, uint seed = 0)
+{
+    return name.hash() ^ seed;
+}
+
+// Таблица имён одного разбора, общая для всех его потоков
+class NameTable : public QSharedData
+{
+public:
+    NameTable();
+    ~NameTable();
+
+    Name intern(const char* data, const int size);
+
+private:
+    QReadWriteLock                  _lock;
+    QHash<QByteArray, Name::Entry*> _hash;
+    QVector<Name::Entry*>           _entries;
+
+    Q_DISABLE_COPY(NameTable)
+};
+
+// Локальный кэш имён: таблица блокируется только при промахе.
+// Копия кэша пишет в ту же таблицу, так потоки одного разбора делят имена.
+class NameCache
+{
+public:
+    NameCache();
+
+    Name get(const Span& str);
+
+private:
+    QExplicitlySharedDataPointer<NameTable> _table;
+    QHash<QByteArray, Name>                 _names;
+};
+}
+
+Q_DECLARE_TYPEINFO(Script::Name, Q_MOVABLE_TYPE);
+
+#endif // NAMES_H
@@ -0,0 +1,138 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "phrasemodel.h"
+
+PhraseModel::PhraseModel(QObject* parent) :
+    QAbstractTableModel(parent),
+    _timecode(25.0, 0)
+{}
+
+int PhraseModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : _phrases.size();
+}
+
+int PhraseModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : COL_COUNT;
+}
+
+QVariant PhraseModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= _phrases.size()) return QVariant();
+    if (Qt::DisplayRole != role && Qt::ToolTipRole != role) return QVariant();
+
+    const Writer::Phrase& phrase = _phrases.at(index.row());
+    switch (index.column())
+    {
+    case COL_START:
+        return _timecode.toString(phrase.start);
+
+    case COL_END:
+        return _timecode.toString(phrase.end);
+
+    case COL_ACTOR:
+        return phrase.actor;
+
+    case COL_TEXT:
+        return phrase.text;
+    }
+    return QVariant();
+}
+
+QVariant PhraseModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (Qt::DisplayRole != role) return QVariant();
+    if (Qt::Vertical == orientation) return section + 1;
+
+    switch (section)
+    {
+    case COL_START:
+        return QString("Начало");
+
+    case COL_END:
+        return QString("Конец");
+
+    case COL_ACTOR:
+        return QString("Актёр");
+
+    case COL_TEXT:
+        return QString("Текст");
+    }
+    return QVariant();
+}
+
+void PhraseModel::setPhrases(const Writer::PhraseList& phrases)
+{
+    // Общий кусок в начале и в конце
+    const int oldSize = _phrases.size(), newSize = phrases.size();
+    int first = 0;
+    while (first < oldSize && first < newSize && _phrases.at(first) == phrases.at(first)) ++first;
+
+    int oldLast = oldSize, newLast = newSize;
+    while (oldLast > first && newLast > first && _phrases.at(oldLast - 1) == phrases.at(newLast - 1))
+    {
+        --oldLast;
+        --newLast;
+    }
+
+    // Строк столько же: только перерисовка изменённых
+    if (oldLast - first == newLast - first)
+    {
+        _phrases = phrases;
+        if (oldLast > first)
+        {
+            emit dataChanged(this->index(first, 0), this->index(oldLast - 1, COL_COUNT - 1), {Qt::DisplayRole, Qt::ToolTipRole});
+        }
+        return;
+    }
+
+    if (oldLast > first)
+    {
+        beginRemoveRows(QModelIndex(), first, oldLast - 1);
+        _phrases = _phrases.mid(0, first) + _phrases.mid(oldLast);
+        endRemoveRows();
+    }
+    if (newLast > first)
+    {
+        beginInsertRows(QModelIndex(), first, newLast - 1);
+        _phrases = phrases;
+        endInsertRows();
+    }
+    else
+    {
+        _phrases = phrases; // Те же строки, но данные общие с источником
+    }
+}
+
+void PhraseModel::clear()
+{
+    beginResetModel();
+    _phrases.clear();
+    endResetModel();
+}
+
+void PhraseModel::setTiming(const double fps, const int timeStart)
+{
+    _timecode = Writer::Timecode(fps, timeStart);
+    if (!_phrases.isEmpty())
+    {
+        emit dataChanged(this->index(0, COL_START), this->index(_phrases.size() - 1, COL_END), {Qt::DisplayRole, Qt::ToolTipRole});
+    }
+}
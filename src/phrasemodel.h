@@ -0,0 +1,56 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHRASEMODEL_H
+#define PHRASEMODEL_H
+
+#include "writer.h"
+#include "timecode.h"
+#include <QAbstractTableModel>
+
+
+// Предпросмотр выгрузки. Строки не форматируются заранее: время и текст
+// готовятся в data(), то есть только для видимых строк.
+class PhraseModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {COL_START, COL_END, COL_ACTOR, COL_TEXT, COL_COUNT};
+
+    explicit PhraseModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // Заменяются только отличающиеся строки: совпадающие начало и конец списка
+    // остаются на месте, и вид не теряет прокрутку и выделение
+    void setPhrases(const Writer::PhraseList& phrases);
+    void clear();
+
+    // Меняется только колонка времени, вид перерисует видимые строки
+    void setTiming(const double fps, const int timeStart);
+
+private:
+    Writer::PhraseList _phrases;
+    Writer::Timecode   _timecode;
+};
+
+#endif // PHRASEMODEL_H
@@ -17,16 +17,153 @@
  */
 
 #include "script.h"
+#include <QAtomicInteger>
 #include <QHash>
-#include <QRegularExpression>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 
 namespace Script
 {
+namespace
+{
+// Имена строк
+const char* const ltStyle      = "style";
+const char* const ltEvent      = "dialogue";
+const char* const ltFormat     = "format";
+const char* const ltScriptType = "scripttype";
+
+// Число полей строки события перед текстом
+const int EVENT_FIELDS = 9;
+
+// Строка события, нарезанная на поля: не больше девяти, остаток целиком - текст
+struct EventParts
+{
+    Span fields[EVENT_FIELDS];
+    int  count;
+    bool hasText;
+    Span text;
+
+    EventParts(const Span& line) :
+        count(0),
+        hasText(false)
+    {
+        FieldReader reader(line);
+        while (count < EVENT_FIELDS && !reader.atEnd()) fields[count++] = reader.next();
+
+        if (!reader.atEnd())
+        {
+            hasText = true;
+            text = reader.rest();
+        }
+    }
+};
+
+// Разбор выбранных полей. Пытаемся спасти большую часть строки.
+void DecodeFields(const EventParts& parts, const int fields, const ScriptType type, NameCache& names, Line::Event& event)
+{
+    // Layer
+    if (parts.count > 0 && (fields & EF_LAYER)) event.layer = parts.fields[0].digitsToUInt();
+
+    // Start
+    if (parts.count > 1 && (fields & EF_START)) event.start = Line::StrToTime(parts.fields[1], type);
+
+    // End
+    if (parts.count > 2 && (fields & EF_END)) event.end = Line::StrToTime(parts.fields[2], type);
+
+    // Style
+    if (parts.count > 3 && (fields & EF_STYLE)) event.style = names.get(parts.fields[3].trimmed());
+
+    // Name
+    if (parts.count > 4 && (fields & EF_ACTOR)) event.actorName = names.get(parts.fields[4].trimmed());
+
+    // MarginL, MarginR, MarginV
+    if (fields & EF_MARGINS)
+    {
+        if (parts.count > 5) event.marginL = parts.fields[5].trimmed().toUShort();
+        if (parts.count > 6) event.marginR = parts.fields[6].trimmed().toUShort();
+        if (parts.count > 7) event.marginV = parts.fields[7].trimmed().toUShort();
+    }
+
+    // Effect
+    if (parts.count > 8 && (fields & EF_EFFECT)) event.effect = parts.fields[8].trimmed().toString();
+
+    // Text
+    if (parts.hasText && (fields & EF_TEXT)) event.text = parts.text.toString();
+}
+}
+
 namespace Line
 {
+namespace
+{
+inline uint Digit(const char c)
+{
+    return static_cast<uint>(static_cast<uchar>(c)) - '0';
+}
+
+inline uint Digit(const QChar c)
+{
+    return static_cast<uint>(c.unicode()) - '0';
+}
+
+// Быстрый разбор строго "H:MM:SS.cc" (SSA/ASS) и "HH:MM:SS,mmm" (SRT)
+template <typename Char>
+bool FastStrToTime(const Char* ptr, const Char* const end, const ScriptType type, uint& result)
+{
+    const bool ssa = SCR_ASS == type || SCR_SSA == type;
+
+    // Часы: в SSA от одной цифры, в SRT ровно две
+    uint hour = 0;
+    int hourDigits = 0;
+    for (; ptr < end && Digit(*ptr) <= 9u; ++ptr, ++hourDigits)
+    {
+        hour = hour * 10u + Digit(*ptr);
+    }
+    if (ssa ? (hourDigits < 1 || hourDigits > 4) : 2 != hourDigits) return false;
+
+    // Остаток имеет фиксированную длину
+    const int tail = ssa ? 9 : 10;
+    if (end - ptr != tail) return false;
+
+    const uint m1 = Digit(ptr[1]), m2 = Digit(ptr[2]),
+               s1 = Digit(ptr[4]), s2 = Digit(ptr[5]),
+               f1 = Digit(ptr[7]), f2 = Digit(ptr[8]),
+               f3 = ssa ? 0u : Digit(ptr[9]);
+    if (':' != ptr[0] || ':' != ptr[3] || (ssa ? '.' : ',') != ptr[6] ||
+        m1 > 9u || m2 > 9u || s1 > 9u || s2 > 9u || f1 > 9u || f2 > 9u || f3 > 9u)
+    {
+        return false;
+    }
+
+    const uint msec = ssa ? (f1 * 10u + f2) * 10u : f1 * 100u + f2 * 10u + f3;
+    result = ((hour * 60u + m1 * 10u + m2) * 60u + s1 * 10u + s2) * 1000u + msec;
+    return true;
+}
+
+// Число с ведущими нулями до указанной ширины
+char* WriteNumber(char* ptr, uint value, const int width)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + value % 10u);
+        value /= 10u;
+    }
+    while (value > 0);
+
+    for (int i = count; i < width; ++i) *ptr++ = '0';
+    while (count > 0) *ptr++ = digits[--count];
+    return ptr;
+}
+}
+
 uint StrToTime(const QString& str, const ScriptType type)
 {
+    uint result;
+    if (FastStrToTime(str.constData(), str.constData() + str.size(), type, result)) return result;
+
     // В этой функции мы пытаемся получить хоть какое-то время из строки.
     // Считаем, что чисел может недоставать только с конца (миллисекунды и далее).
     uint hour = 0,
@@ -72,24 +209,64 @@ uint StrToTime(const QString& str, const ScriptType type)
     return ((hour * 60u + min) * 60u + sec) * 1000u + msec;
 }
 
-QString TimeToStr(const uint time, const ScriptType type)
+uint StrToTime(const Span& str, const ScriptType type)
+{
+    uint result;
+    if (FastStrToTime(str.data(), str.end(), type, result)) return result;
+
+    return StrToTime(str.toString(), type);
+}
+
+char* FormatTime(char* buffer, const uint time, const ScriptType type)
 {
     const uint hour = time / 3600000u,
                min  = time / 60000u % 60u,
                sec  = time / 1000u  % 60u,
                msec = time % 1000u;
 
-    QString ret;
-    if (SCR_ASS == type || SCR_SSA == type)
-    {
-        ret = QString("%1:%2:%3.%4").arg(hour).arg(min, 2, 10, QChar('0')).arg(sec, 2, 10, QChar('0')).arg(msec / 10u, 2, 10, QChar('0'));
-    }
-    else
+    const bool ssa = SCR_ASS == type || SCR_SSA == type;
+    char* ptr = WriteNumber(buffer, hour, ssa ? 1 : 2);
+    *ptr++ = ':';
+    ptr = WriteNumber(ptr, min, 2);
+    *ptr++ = ':';
+    ptr = WriteNumber(ptr, sec, 2);
+    *ptr++ = ssa ? '.' : ',';
+    return ssa ? WriteNumber(ptr, msec / 10u, 2) : WriteNumber(ptr, msec, 3);
+}
+
+QString TimeToStr(const uint time, const ScriptType type)
+{
+    char buffer[TIME_BUFFER_SIZE];
+    const char* const end = FormatTime(buffer, time, type);
+
+    return QString::fromLatin1(buffer, static_cast<int>(end - buffer));
+}
+
+namespace
+{
+// Время прямо в поток, без промежуточной строки
+QTextStream& WriteTime(QTextStream& out, const uint time, const ScriptType type)
+{
+    char buffer[TIME_BUFFER_SIZE];
+    const char* const end = FormatTime(buffer, time, type);
+
+    return out << QLatin1String(buffer, static_cast<int>(end - buffer));
+}
+
+// Цвет ASS: "&H" и 8 шестнадцатеричных цифр
+QTextStream& WriteColour(QTextStream& out, quint32 colour)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    char buffer[10] = {'&', 'H'};
+    for (int i = 9; i >= 2; --i)
     {
-        ret = QString("%1:%2:%3,%4").arg(hour, 2, 10, QChar('0')).arg(min, 2, 10, QChar('0')).arg(sec, 2, 10, QChar('0')).arg(msec, 3, 10, QChar('0'));
+        buffer[i] = digits[colour & 0xFu];
+        colour >>= 4;
     }
 
-    return ret;
+    return out << QLatin1String(buffer, 10);
+}
 }
 
 // Базовая строка
@@ -100,10 +277,10 @@ Base::Base(const QString& value) :
     _value(value)
 {}
 
-QString Base::generate(const ScriptType type) const
+void Base::generate(QTextStream& out, const ScriptType type) const
 {
     Q_UNUSED(type);
-    return _value;
+    out << _value;
 }
 
 // Простейшая строка с двоеточием
@@ -121,35 +298,32 @@ void Named::clearBefore()
     _before.clear();
 }
 
+void Named::prependBefore(const QStringList& before)
+{
+    if (!before.isEmpty()) _before = before + _before;
+}
+
 QString Named::name() const
 {
     return _name;
 }
 
-QString Named::generate(const ScriptType type, const QString& value) const
+void Named::generateName(QTextStream& out) const
 {
-    QString result;
-
-    if (SCR_ASS == type || SCR_SSA == type)
+    for (const QString& line : _before)
     {
-        if (_before.length())
-        {
-            result.append( _before.join("\n") );
-            result.append("\n");
-        }
-        result.append( QString("%1: %2").arg(_name).arg(value) );
+        out << line << '\n';
     }
-
-    return result;
+    out << _name << ": ";
 }
 
-QString Named::generate(const ScriptType type) const
+void Named::generate(QTextStream& out, const ScriptType type) const
 {
-    QString result;
-
-    if (SCR_ASS == type || SCR_SSA == type) result = this->generate(type, text);
-
-    return result;
+    if (SCR_ASS == type || SCR_SSA == type)
+    {
+        this->generateName(out);
+        out << text;
+    }
 }
 
 // Строка стиля
@@ -192,74 +366,67 @@ void Style::init()
     encoding        = 1;
 }
 
-QString Style::generate(const ScriptType type) const
+void Style::generate(QTextStream& out, const ScriptType type) const
 {
-    QString result;
-
-    if (SCR_ASS == type || SCR_SSA == type)
-    {
-        QStringList list;
-
-        list.append(styleName);
-        list.append(fontName);
-        list.append( QString::number(fontSize, 'g', 10) );
+    if (SCR_ASS != type && SCR_SSA != type) return;
 
-        if (SCR_ASS == type)
-        {
-            list.append( QString("&H%1").arg(primaryColour,   8, 16, QChar('0')).toUpper() );
-            list.append( QString("&H%1").arg(secondaryColour, 8, 16, QChar('0')).toUpper() );
-            list.append( QString("&H%1").arg(outlineColour,   8, 16, QChar('0')).toUpper() );
-            list.append( QString("&H%1").arg(backColour,      8, 16, QChar('0')).toUpper() );
-        }
-        else
-        {
-            list.append( QString::number( static_cast<qint32>(primaryColour) ) );
-            list.append( QString::number( static_cast<qint32>(secondaryColour) ) );
-            list.append( QString::number( static_cast<qint32>(outlineColour) ) );
-            list.append( QString::number( static_cast<qint32>(backColour) ) );
-        }
+    this->generateName(out);
 
-        list.append( bold   ? "-1" : "0" );
-        list.append( italic ? "-1" : "0" );
+    out << styleName << ',';
+    out << fontName << ',';
+    out << QString::number(fontSize, 'g', 10) << ',';
 
-        if (SCR_ASS == type)
-        {
-            list.append( underline ? "-1" : "0" );
-            list.append( strikeOut ? "-1" : "0" );
-            list.append( QString::number(scaleX,  'g', 10) );
-            list.append( QString::number(scaleY,  'g', 10) );
-            list.append( QString::number(spacing, 'g', 10) );
-            list.append( QString::number(angle,   'g', 10) );
-        }
+    if (SCR_ASS == type)
+    {
+        WriteColour(out, primaryColour)   << ',';
+        WriteColour(out, secondaryColour) << ',';
+        WriteColour(out, outlineColour)   << ',';
+        WriteColour(out, backColour)      << ',';
+    }
+    else
+    {
+        out << static_cast<qint32>(primaryColour)   << ',';
+        out << static_cast<qint32>(secondaryColour) << ',';
+        out << static_cast<qint32>(outlineColour)   << ',';
+        out << static_cast<qint32>(backColour)      << ',';
+    }
 
-        list.append( QString::number(borderStyle) );
-        list.append( QString::number(outline, 'g', 10) );
-        list.append( QString::number(shadow,  'g', 10) );
+    out << (bold   ? "-1" : "0") << ',';
+    out << (italic ? "-1" : "0") << ',';
 
-        if (SCR_SSA == type && alignment > 0 && alignment < AlignmentASS.length())
-        {
-            list.append( QString::number(AlignmentASS.at(alignment)) );
-        }
-        else
-        {
-            list.append( QString::number(alignment) );
-        }
+    if (SCR_ASS == type)
+    {
+        out << (underline ? "-1" : "0") << ',';
+        out << (strikeOut ? "-1" : "0") << ',';
+        out << QString::number(scaleX,  'g', 10) << ',';
+        out << QString::number(scaleY,  'g', 10) << ',';
+        out << QString::number(spacing, 'g', 10) << ',';
+        out << QString::number(angle,   'g', 10) << ',';
+    }
 
-        list.append( QString::number(marginL) );
-        list.append( QString::number(marginR) );
-        list.append( QString::number(marginV) );
+    out << borderStyle << ',';
+    out << QString::number(outline, 'g', 10) << ',';
+    out << QString::number(shadow,  'g', 10) << ',';
 
-        if (SCR_SSA == type)
-        {
-            list.append("0");
-        }
+    if (SCR_SSA == type && alignment > 0 && alignment < AlignmentASS.length())
+    {
+        out << AlignmentASS.at(alignment) << ',';
+    }
+    else
+    {
+        out << alignment << ',';
+    }
 
-        list.append( QString::number(encoding) );
+    out << marginL << ',';
+    out << marginR << ',';
+    out << marginV << ',';
 
-        result = Named::generate(type, list.join(','));
+    if (SCR_SSA == type)
+    {
+        out << "0,";
     }
 
-    return result;
+    out << encoding;
 }
 
 // Строка события
@@ -277,52 +444,80 @@ Event::Event(const QStringList& before) :
 
 void Event::init()
 {
-    layer   = 0;
-    start   = 0;
-    end     = 0;
-    style   = defaultStyle;
-    marginL = 0;
-    marginR = 0;
-    marginV = 0;
+    layer    = 0;
+    start    = 0;
+    end      = 0;
+    marginL  = 0;
+    marginR  = 0;
+    marginV  = 0;
 }
 
-QString Event::generate(const ScriptType type) const
+void Event::generate(QTextStream& out, const ScriptType type) const
 {
-    QString result;
-
     if (SCR_ASS == type || SCR_SSA == type)
     {
-        QStringList list;
+        this->generateName(out);
 
         if (SCR_SSA == type)
         {
-            list.append( QString("Marked=%1").arg(layer) );
+            out << "Marked=" << layer << ',';
         }
         else
         {
-            list.append( QString::number(layer) );
+            out << layer << ',';
         }
 
-        list.append( TimeToStr(start, type) );
-        list.append( TimeToStr(end, type) );
-        list.append(style);
-        list.append(actorName);
-        list.append( QString::number(marginL) );
-        list.append( QString::number(marginR) );
-        list.append( QString::number(marginV) );
-        list.append(effect);
-        list.append(text);
-
-        result = Named::generate(type, list.join(','));
+        WriteTime(out, start, type) << ',';
+        WriteTime(out, end, type)   << ',';
+        out << (style.isEmpty() ? defaultStyle : style.toString()) << ',';
+        out << actorName.toString() << ',';
+        out << marginL << ',';
+        out << marginR << ',';
+        out << marginV << ',';
+        out << effect << ',';
+        out << text;
     }
     else if (SCR_SRT == type)
     {
-        result.append( QString("%1 --> %2\n").arg(TimeToStr(start, type)).arg(TimeToStr(end, type)) );
-        result.append( QString(text).replace("\\N", "\n", Qt::CaseInsensitive) );
+        WriteTime(out, start, type) << " --> ";
+        WriteTime(out, end, type)   << '\n';
+
+        // "\N" -> перевод строки, кусками без копии текста
+        int from = 0, pos;
+        while (-1 != (pos = text.indexOf("\\N", from, Qt::CaseInsensitive)))
+        {
+            out << text.midRef(from, pos - from) << '\n';
+            from = pos + 2;
+        }
+        out << text.midRef(from);
     }
+}
+}
 
-    return result;
+// Секция без разбора
+void RawSection::append(const Span& data)
+{
+    if (data.isEmpty()) return;
+
+    if (!content.isEmpty() && !content.endsWith('\n')) content.append('\n');
+    content.append(data.data(), data.size());
 }
+
+void RawSection::generate(QTextStream& out, const ScriptType type) const
+{
+    if (SCR_ASS != type && SCR_SSA != type) return;
+
+    out << '[' << (SEC_FONTS == _sectionType ? Sections::fonts : Sections::graphics) << "]\n";
+
+    // Строки режутся только при сохранении, пустые пропускаются, как раньше
+    Tokenizer in(content.constData(), content.size());
+    while ( !in.atEnd() )
+    {
+        const Span line = in.readLine();
+        if (line.isEmpty()) continue;
+
+        out << line.toString() << '\n';
+    }
 }
 
 // Скрипт
@@ -365,47 +560,54 @@ void Script::appendAfter(const QStringList& after)
     _after.append(after);
 }
 
-QString Script::generate(const ScriptType type) const
+void Script::generate(QTextStream& out, const ScriptType type) const
 {
-    QString result;
-
     if (SCR_ASS == type || SCR_SSA == type)
     {
-        if (_before.length())
+        for (const QString& line : _before)
         {
-            result.append( _before.join("\n") );
-            result.append("\n");
+            out << line << '\n';
         }
 
-        result.append( header.generate(type) );
-        result.append("\n");
-        result.append( styles.generate(type) );
-        result.append("\n");
-        result.append( events.generate(type) );
+        header.generate(out, type);
+        out << '\n';
+        styles.generate(out, type);
+        out << '\n';
+        events.generate(out, type);
 
         if (!fonts.isEmpty())
         {
-            result.append("\n");
-            result.append( fonts.generate(type) );
+            out << '\n';
+            fonts.generate(out, type);
         }
 
         if (!graphics.isEmpty())
         {
-            result.append("\n");
-            result.append( graphics.generate(type) );
+            out << '\n';
+            graphics.generate(out, type);
         }
 
         if (_after.length())
         {
-            result.append("\n");
-            result.append( _after.join("\n") );
-            result.append("\n");
+            out << '\n';
+            for (const QString& line : _after)
+            {
+                out << line << '\n';
+            }
         }
     }
     else if (SCR_SRT == type)
     {
-        result = events.generate(type);
+        events.generate(out, type);
     }
+}
+
+QString Script::generate(const ScriptType type) const
+{
+    QString result;
+    QTextStream out(&result);
+    this->generate(out, type);
+    out.flush();
 
     return result;
 }
@@ -413,37 +615,355 @@ QString Script::generate(const ScriptType type) const
 //
 // Определение формата
 //
-ScriptType DetectFormat(QTextStream &in)
+namespace
 {
-    in.seek(0);
+// Сколько байт просматривать в поисках формата, пока не встретился заголовок SSA
+const qint64 SNIFF_LIMIT = 64 * 1024;
 
-    QString str = in.read(5120);
-    if (str.contains(QRegularExpression("ScriptType *: *v4\\.00\\+")))
-    {
-        return SCR_ASS;
-    }
-    else if (str.contains(QRegularExpression("ScriptType *: *v4\\.00")))
+// Строго "dd:dd:dd,ddd"
+bool IsSRTTime(const char* ptr)
+{
+    for (int i = 0; i < 12; ++i)
     {
-        return SCR_SSA;
+        const char c = ptr[i];
+        const bool ok = 2 == i || 5 == i ? ':' == c :
+                        8 == i           ? ',' == c :
+                                           c >= '0' && c <= '9';
+        if (!ok) return false;
     }
-    else if (str.contains(QRegularExpression("\\d{2}:\\d{2}:\\d{2},\\d{3} *--> *\\d{2}:\\d{2}:\\d{2},\\d{3}")))
+    return true;
+}
+
+// Аналог "^(\d{2}:\d{2}:\d{2},\d{3}) *--> *(\d{2}:\d{2}:\d{2},\d{3})$"
+bool SplitSRTTiming(const Span& line, Span& start, Span& end)
+{
+    const int len = 12;
+    if (line.size() < len * 2 + 3 || !IsSRTTime(line.data()) || !IsSRTTime(line.end() - len)) return false;
+
+    const char* ptr = line.data() + len;
+    const char* last = line.end() - len;
+    while (ptr < last && ' ' == *ptr) ++ptr;
+    while (last > ptr && ' ' == *(last - 1)) --last;
+    if (3 != last - ptr || 0 != memcmp(ptr, "-->", 3)) return false;
+
+    start = line.left(len);
+    end   = line.mid(line.size() - len);
+    return true;
+}
+}
+
+// Один проход по байтам: версия из ScriptType или секции стилей, либо строка времени SRT
+ScriptType DetectFormat(const char* data, const qint64 size)
+{
+    Tokenizer in(data, size);
+
+    // Пропускаем BOM UTF-8
+    if (size >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3)) in.seek(3);
+
+    Span line, name, value, start, end;
+    bool ssa = false, scriptInfo = false;
+    while ( !in.atEnd() )
     {
-        return SCR_SRT;
+        // Не SSA: дальше смотреть нет смысла
+        if (!ssa && in.pos() > SNIFF_LIMIT) break;
+
+        line = in.readLine();
+        if (line.isEmpty()) continue;
+
+        if (SectionName(line, name))
+        {
+            name = name.trimmed();
+            if (name.equals(Sections::stylesASS)) return SCR_ASS;
+            if (name.equals(Sections::stylesSSA)) return SCR_SSA;
+            if (name.equals(Sections::events) && ssa) return SCR_SSA;
+
+            scriptInfo = name.equals(Sections::header);
+            ssa = ssa || scriptInfo;
+        }
+        else if (scriptInfo)
+        {
+            // Версия файла, комментарии перед ней не мешают
+            if (SplitNamed(line, name, value) && name.equals(ltScriptType))
+            {
+                if (value.equals("v4.00+")) return SCR_ASS;
+                if (value.equals("v4.00")) return SCR_SSA;
+            }
+        }
+        else if (!ssa && SplitSRTTiming(line, start, end))
+        {
+            return SCR_SRT;
+        }
     }
 
-    return SCR_UNKNOWN;
+    return ssa ? SCR_SSA : SCR_UNKNOWN;
 }
 
 //
 // Парсер SSA
 //
-bool ParseSSA(QTextStream& in, Script& script)
+namespace
+{
+// Минимальный объём секции событий для параллельного разбора
+const qint64 PARALLEL_MIN_SIZE = 1024 * 1024;
+
+// Ход разбора сообщается не чаще, чем раз на столько байт
+const qint64 PROGRESS_STEP = 256 * 1024;
+
+// Редкие вызовы ParseProgress из цикла разбора
+class ProgressReporter
+{
+public:
+    ProgressReporter(ParseProgress* progress, const qint64 total) :
+        _progress(progress),
+        _total(total),
+        _last(0),
+        _next(0)
+    {}
+
+    // false - разбор отменён
+    bool operator()(const qint64 pos)
+    {
+        if (nullptr == _progress || pos < _next) return true;
+
+        _last = pos;
+        _next = pos + PROGRESS_STEP;
+        return _progress->update(pos, _total);
+    }
+
+    // Только проверка отмены, ход остаётся прежним
+    bool check()
+    {
+        return nullptr == _progress || _progress->update(_last, _total);
+    }
+
+    qint64 total() const { return _total; }
+
+    bool finish()
+    {
+        return nullptr == _progress || _progress->update(_total, _total);
+    }
+
+private:
+    ParseProgress* _progress;
+    qint64         _total;
+    qint64         _last;
+    qint64         _next;
+};
+
+// Ход параллельного разбора: куски складывают пройденные байты в общий счётчик
+class SharedProgress
+{
+public:
+    SharedProgress(ParseProgress* progress, const qint64 done, const qint64 total) :
+        _progress(progress),
+        _total(total),
+        _done(done),
+        _cancelled(0)
+    {}
+
+    // false - разбор отменён, в том числе из другого куска
+    bool add(const qint64 bytes)
+    {
+        if (this->isCancelled()) return false;
+
+        const qint64 done = _done.fetchAndAddRelaxed(bytes) + bytes;
+        if (nullptr != _progress && !_progress->update(done, _total))
+        {
+            _cancelled.storeRelease(1);
+            return false;
+        }
+        return true;
+    }
+
+    bool isCancelled() const { return 0 != _cancelled.loadAcquire(); }
+
+private:
+    ParseProgress*         _progress;
+    qint64                 _total;
+    QAtomicInteger<qint64> _done;
+    QAtomicInt             _cancelled;
+};
+
+// Строка события: разбираем поля из fields, остальные остаются по умолчанию
+void DecodeEvent(const Span& text, const ScriptType type, NameCache& names, const int fields, Line::Event& event)
 {
-    in.seek(0);
+    DecodeFields(EventParts(text), fields, type, names, event);
+}
+
+// Строка секции событий. Мусор копится в before и уходит в следующее событие.
+void ParseEvent(const Span& line, const ScriptType type, const ParseOptions& options, NameCache& names, QStringList& before, QVector<Line::Event>& events)
+{
+    Span name, text;
 
-    // Регулярка для определения секции
-    QRegularExpression reSection("^\\[([^\\]]+?)\\]$");
-    QRegularExpressionMatch match;
+    // Нормальная строка
+    if (SplitNamed(line, name, text))
+    {
+        // Строка события
+        if (name.equals(ltEvent))
+        {
+            events.append(Line::Event(before));
+            before.clear();
+
+            DecodeEvent(text, type, names, options.fields, events.last());
+            return;
+        }
+        // Строка формата - пропускаем
+        else if (name.equals(ltFormat))
+        {
+            return;
+        }
+    }
+
+    // Мусор
+    before.append(line.toString());
+}
+
+// Начало следующего заголовка секции или конец буфера. Строки не режутся:
+// ищем '[' в начале строки, поэтому мегабайты шрифтов пролетают через memchr.
+qint64 SkipSection(const Tokenizer& in)
+{
+    const char* const data  = in.data();
+    const char* const begin = data + in.pos();
+    const char* const end   = data + in.size();
+
+    Span name;
+    const char* ptr = begin;
+    while (ptr < end)
+    {
+        const char* const bracket = static_cast<const char*>(memchr(ptr, '[', static_cast<size_t>(end - ptr)));
+        if (nullptr == bracket) break;
+        ptr = bracket + 1;
+
+        // Перед скобкой в строке могут быть только пробелы
+        const char* lineBegin = bracket;
+        while (lineBegin > begin && '\n' != lineBegin[-1] && Span::isSpace(lineBegin[-1])) --lineBegin;
+        if (lineBegin > begin && '\n' != lineBegin[-1]) continue;
+
+        const void* const newLine = memchr(bracket, '\n', static_cast<size_t>(end - bracket));
+        const char* const lineEnd = nullptr == newLine ? end : static_cast<const char*>(newLine);
+        if (SectionName(Span(bracket, static_cast<int>(lineEnd - bracket)).trimmed(), name)) return lineBegin - data;
+    }
+    return in.size();
+}
+
+// Конец текущей секции (начало заголовка следующей) и число строк до него.
+// Предварительный проход разбор не двигает, но отмену проверяет. false - отменено.
+bool FindSectionEnd(Tokenizer in, ProgressReporter& report, qint64& end, int& lines)
+{
+    Span name;
+    lines = 0;
+    qint64 next = in.pos() + PROGRESS_STEP;
+    while ( !in.atEnd() )
+    {
+        const qint64 lineBegin = in.pos();
+        if (lineBegin >= next)
+        {
+            if ( !report.check() ) return false;
+            next = lineBegin + PROGRESS_STEP;
+        }
+
+        if (SectionName(in.readLine(), name))
+        {
+            end = lineBegin;
+            return true;
+        }
+        ++lines;
+    }
+    end = in.pos();
+    return true;
+}
+
+// Кусок секции событий для параллельного разбора
+struct EventChunk
+{
+    Span                 data;
+    QVector<Line::Event> events;
+    QStringList          tail; // Мусор после последнего события
+    NameCache            names;
+};
+
+struct ParseEventChunk
+{
+    ScriptType      type;
+    ParseOptions    options;
+    SharedProgress* progress;
+
+    void operator()(EventChunk& chunk) const
+    {
+        Tokenizer in(chunk.data.data(), chunk.data.size());
+        qint64 reported = 0;
+        while ( !in.atEnd() )
+        {
+            if (in.pos() - reported >= PROGRESS_STEP)
+            {
+                if ( !progress->add(in.pos() - reported) ) return;
+                reported = in.pos();
+            }
+
+            const Span line = in.readLine();
+            if (!line.isEmpty()) ParseEvent(line, type, options, chunk.names, chunk.tail, chunk.events);
+        }
+        progress->add(in.pos() - reported);
+    }
+};
+
+// Разбор секции событий на пуле потоков до позиции end (заголовок следующей секции),
+// оставшийся мусор возвращается в before. Если секция мала, ничего не делает.
+// false - разбор отменён.
+bool ParseEventsParallel(Tokenizer& in, const qint64 end, const ScriptType type, const ParseOptions& options, const NameCache& names, const qint64 total, Script& script, QStringList& before)
+{
+    const qint64 begin = in.pos();
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    if (threads < 2 || end - begin < PARALLEL_MIN_SIZE) return true;
+
+    // Режем по границам строк, с запасом кусков на каждый поток
+    const qint64 chunkSize = qMax<qint64>((end - begin) / (threads * 4), 64 * 1024);
+    QVector<EventChunk> chunks;
+    for (qint64 pos = begin; pos < end;)
+    {
+        qint64 next = qMin(pos + chunkSize, end);
+        if (next < end)
+        {
+            const void* const ptr = memchr(in.data() + next, '\n', static_cast<size_t>(end - next));
+            next = nullptr == ptr ? end : static_cast<const char*>(ptr) - in.data() + 1;
+        }
+
+        EventChunk chunk;
+        chunk.data  = Span(in.data() + pos, static_cast<int>(next - pos));
+        chunk.names = names; // Все куски пишут в таблицу имён этого разбора
+        chunks.append(chunk);
+        pos = next;
+    }
+
+    SharedProgress progress(options.progress, begin, total);
+    QtConcurrent::blockingMap(chunks, ParseEventChunk{type, options, &progress});
+    if (progress.isCancelled()) return false;
+
+    // Сшиваем в исходном порядке
+    for (EventChunk& chunk : chunks)
+    {
+        if (chunk.events.isEmpty())
+        {
+            before.append(chunk.tail);
+            continue;
+        }
+
+        chunk.events.first().prependBefore(before);
+        script.events.append(chunk.events);
+        before = chunk.tail;
+    }
+
+    in.seek(end);
+    return true;
+}
+}
+
+bool ParseSSA(const char* data, const qint64 size, Script& script, const ParseOptions& options)
+{
+    Tokenizer in(data, size);
+
+    // Пропускаем BOM UTF-8
+    if (size >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3)) in.seek(3);
 
     // Таблица состояний
     QHash<QString, SectionType> sectionTable = {
@@ -463,24 +983,22 @@ bool ParseSSA(QTextStream& in, Script& script)
         {Sections::stylesASS.toLower(), SCR_ASS}
     };
 
-    // Имена строк
-    const QString ltStyle      = "style";
-    const QString ltEvent      = "dialogue";
-    const QString ltFormat     = "format";
-    const QString ltScriptType = "scripttype";
-
-    QString line, name, text, tempStr;
+    Span line, name, text, sectionName;
+    NameCache names;
+    QString tempStr;
     SectionType state = SEC_UNKNOWN;
     QStringList tempStrList, tempList;
     bool readNext = true, atBegin = true;
     ScriptType type = SCR_SSA;
-    int pos;
+    ProgressReporter report(options.progress, size);
     while ( !in.atEnd() )
     {
+        if ( !report(in.pos()) ) return false;
+
         // Если вернулись из секции, имя новой секции надо сохранить
         if (readNext)
         {
-            line = in.readLine().trimmed();
+            line = in.readLine();
         }
         else
         {
@@ -495,9 +1013,9 @@ bool ParseSSA(QTextStream& in, Script& script)
         // Вне секций
         case SEC_UNKNOWN:
             // Нашли заголовок
-            if ((match = reSection.match(line)).hasMatch())
+            if (SectionName(line, sectionName))
             {
-                tempStr = match.captured(1).trimmed().toLower();
+                tempStr = sectionName.trimmed().toString().toLower();
 
                 // Есть ли такой заголовок в таблице?
                 if (sectionTable.contains(tempStr))
@@ -517,6 +1035,31 @@ bool ParseSSA(QTextStream& in, Script& script)
                         script.appendBefore(tempStrList);
                         tempStrList.clear();
                     }
+
+                    if (SEC_EVENTS == state)
+                    {
+                        // Место под события выделяем сразу
+                        qint64 end;
+                        int lines;
+                        if ( !FindSectionEnd(in, report, end, lines) ) return false;
+                        script.events.reserve(script.events.content.size() + lines);
+
+                        // Большую секцию разбираем параллельно
+                        if (options.parallel && !ParseEventsParallel(in, end, type, options, names, report.total(), script, tempStrList)) return false;
+                    }
+                    // Вложения не разбираем: секция целиком одним куском или пропуск
+                    else if (SEC_FONTS == state || SEC_GRAPHICS == state)
+                    {
+                        const qint64 end = SkipSection(in);
+                        if (options.attachments)
+                        {
+                            RawSection& section = SEC_FONTS == state ? script.fonts : script.graphics;
+                            section.append(Span(in.data() + in.pos(), static_cast<int>(end - in.pos())));
+                        }
+                        in.seek(end);
+                        state = SEC_UNKNOWN;
+                    }
+                    break;
                 }
             }
 
@@ -524,18 +1067,21 @@ bool ParseSSA(QTextStream& in, Script& script)
             //! @todo: временно отключено - мусор ломает формат
             /*if (SEC_UNKNOWN == state)
             {
-                tempStrList.append(line);
+                tempStrList.append(line.toString());
             }*/
+
+            // Неизвестная секция или мусор вне секций: сразу к следующему заголовку
+            in.seek(SkipSection(in));
             break;
 
         case SEC_HEADER:
             // Такой комментарий может быть только в заголовке
             if ( line.startsWith(';') )
             {
-                tempStrList.append(line);
+                tempStrList.append(line.toString());
             }
             // Началась другая секция
-            else if (reSection.match(line).hasMatch())
+            else if (SectionName(line, sectionName))
             {
                 script.header.appendAfter(tempStrList);
                 tempStrList.clear();
@@ -544,15 +1090,12 @@ bool ParseSSA(QTextStream& in, Script& script)
                 state = SEC_UNKNOWN;
             }
             // Нормальная строка
-            else if ( -1 != ( pos = line.indexOf(':') ) )
+            else if (SplitNamed(line, name, text))
             {
-                name = line.left(pos).trimmed();
-                text = line.mid(pos + 1).trimmed();
-
                 // Версия файла (шо, опять?)
-                if (ltScriptType == name.toLower())
+                if (name.equals(ltScriptType))
                 {
-                    tempStr = text.toLower();
+                    tempStr = text.toString().toLower();
                     if (typeTable.contains(tempStr))
                     {
                         type = typeTable[tempStr];
@@ -560,23 +1103,23 @@ bool ParseSSA(QTextStream& in, Script& script)
                 }
                 else
                 {
-                    Line::Named* ptr = new Line::Named(name, tempStrList);
+                    Line::Named named(name.toString(), tempStrList);
                     tempStrList.clear();
 
-                    ptr->text = line.mid(pos + 1).trimmed();
-                    script.header.append(ptr);
+                    named.text = text.toString();
+                    script.header.append(std::move(named));
                 }
             }
             // Мусор
             else
             {
-                tempStrList.append(line);
+                tempStrList.append(line.toString());
             }
             break;
 
         case SEC_STYLES:
             // Началась другая секция
-            if (reSection.match(line).hasMatch())
+            if (SectionName(line, sectionName))
             {
                 script.styles.appendAfter(tempStrList);
                 tempStrList.clear();
@@ -585,19 +1128,16 @@ bool ParseSSA(QTextStream& in, Script& script)
                 state = SEC_UNKNOWN;
             }
             // Нормальная строка
-            else if ( -1 != ( pos = line.indexOf(':') ) )
+            else if (SplitNamed(line, name, text))
             {
-                name = line.left(pos).trimmed();
-                text = line.mid(pos + 1).trimmed();
-
-                tempStr = name.toLower();
                 // Строка стиля
-                if (ltStyle == tempStr)
+                if (name.equals(ltStyle))
                 {
-                    Line::Style* ptr = new Line::Style(tempStrList);
+                    script.styles.append(Line::Style(tempStrList));
+                    Line::Style* const ptr = &script.styles.content.last();
                     tempStrList.clear();
 
-                    tempList = text.split(',');
+                    tempList = text.toString().split(',');
 
                     // Пытаемся спасти большую часть строки
                     // Name
@@ -811,26 +1351,25 @@ bool ParseSSA(QTextStream& in, Script& script)
                         ptr->encoding = tempList.first().trimmed().toUShort();
                     }
 
-                    script.styles.append(ptr);
                 }
                 // Строка формата - пропускаем
-                else if (ltFormat == tempStr) {}
+                else if (name.equals(ltFormat)) {}
                 // Мусор
                 else
                 {
-                    tempStrList.append(line);
+                    tempStrList.append(line.toString());
                 }
             }
             // Мусор
             else
             {
-                tempStrList.append(line);
+                tempStrList.append(line.toString());
             }
             break;
 
         case SEC_EVENTS:
             // Началась другая секция
-            if (reSection.match(line).hasMatch())
+            if (SectionName(line, sectionName))
             {
                 script.events.appendAfter(tempStrList);
                 tempStrList.clear();
@@ -838,134 +1377,16 @@ bool ParseSSA(QTextStream& in, Script& script)
                 readNext = false;
                 state = SEC_UNKNOWN;
             }
-            // Нормальная строка
-            else if ( -1 != ( pos = line.indexOf(':') ) )
-            {
-                name = line.left(pos).trimmed();
-                text = line.mid(pos + 1).trimmed();
-
-                tempStr = name.toLower();
-                // Строка события
-                if (ltEvent == tempStr)
-                {
-                    Line::Event* ptr = new Line::Event(tempStrList);
-                    tempStrList.clear();
-
-                    tempList = text.split(',');
-
-                    // Пытаемся спасти большую часть строки
-                    // Layer
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->layer = tempList.first().remove(QRegularExpression("\\D")).toUInt();
-                        tempList.removeFirst();
-                    }
-
-                    // Start
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->start = Line::StrToTime(tempList.first(), type);
-                        tempList.removeFirst();
-                    }
-
-                    // End
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->end = Line::StrToTime(tempList.first(), type);
-                        tempList.removeFirst();
-                    }
-
-                    // Style
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->style = tempList.first().trimmed();
-                        tempList.removeFirst();
-                    }
-
-                    // Name
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->actorName = tempList.first().trimmed();
-                        tempList.removeFirst();
-                    }
-
-                    // MarginL
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->marginL = tempList.first().trimmed().toUShort();
-                        tempList.removeFirst();
-                    }
-
-                    // MarginR
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->marginR = tempList.first().trimmed().toUShort();
-                        tempList.removeFirst();
-                    }
-
-                    // MarginV
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->marginV = tempList.first().trimmed().toUShort();
-                        tempList.removeFirst();
-                    }
-
-                    // Effect
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->effect = tempList.first().trimmed();
-                        tempList.removeFirst();
-                    }
-
-                    // Text
-                    if (!tempList.isEmpty())
-                    {
-                        ptr->text = tempList.join(',');
-                    }
-
-                    script.events.append(ptr);
-                }
-                // Строка формата - пропускаем
-                else if (ltFormat == tempStr) {}
-                // Мусор
-                else
-                {
-                    tempStrList.append(line);
-                }
-            }
-            // Мусор
+            // Событие или мусор
             else
             {
-                tempStrList.append(line);
+                ParseEvent(line, type, options, names, tempStrList, script.events.content);
             }
             break;
 
+        // Вложения забираются целиком при входе в секцию
         case SEC_FONTS:
-            // Началась другая секция
-            if (reSection.match(line).hasMatch())
-            {
-                readNext = false;
-                state = SEC_UNKNOWN;
-            }
-            // Контент
-            else
-            {
-                script.fonts.append(new Line::Base(line));
-            }
-            break;
-
         case SEC_GRAPHICS:
-            // Началась другая секция
-            if (reSection.match(line).hasMatch())
-            {
-                readNext = false;
-                state = SEC_UNKNOWN;
-            }
-            // Контент
-            else
-            {
-                script.graphics.append(new Line::Base(line));
-            }
             break;
         }
     }
@@ -976,6 +1397,41 @@ bool ParseSSA(QTextStream& in, Script& script)
         script.appendAfter(tempStrList);
     }
 
+    return report.finish();
+}
+
+bool ParseSSA(const char* data, const qint64 size, EventHandler& handler, const int fields)
+{
+    Tokenizer in(data, size);
+
+    // Пропускаем BOM UTF-8
+    if (size >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3)) in.seek(3);
+
+    // Нужна только секция событий, остальное пропускаем не разбирая.
+    // Время в SSA и ASS записывается одинаково, поэтому тип файла не важен.
+    Span line, name, text, sectionName;
+    NameCache names;
+    bool inEvents = false;
+    while ( !in.atEnd() )
+    {
+        line = in.readLine();
+        if (line.isEmpty()) continue;
+
+        if (SectionName(line, sectionName))
+        {
+            inEvents = sectionName.trimmed().equals(Sections::events);
+
+            // Остальные секции пролистываем, не разрезая на строки
+            if (!inEvents) in.seek(SkipSection(in));
+        }
+        else if (inEvents && SplitNamed(line, name, text) && name.equals(ltEvent))
+        {
+            Line::Event event;
+            DecodeEvent(text, SCR_ASS, names, fields, event);
+            handler.event(event);
+        }
+    }
+
     return true;
 }
 
@@ -984,24 +1440,81 @@ bool ParseSSA(QTextStream& in, Script& script)
 //
 enum SRTState {SRTST_EMPTY, SRTST_NEW, SRTST_TEXT};
 
-bool ParseSRT(QTextStream& in, Script& script)
+namespace
 {
-    in.seek(0);
+// Складывает события в скрипт
+class ScriptEventHandler : public EventHandler
+{
+public:
+    ScriptEventHandler(Script& script) :
+        _script(script)
+    {}
+
+    void event(const Line::Event& event) override
+    {
+        _script.events.append(event);
+    }
+
+private:
+    Script& _script;
+};
+}
+
+bool ParseSRT(const char* data, const qint64 size, Script& script, ParseProgress* progress)
+{
+    ScriptEventHandler handler(script);
+    if ( !ParseSRT(data, size, handler, progress) ) return false;
+
+    // Важные заголовки
+    Line::Named named("WrapStyle", QStringList("; Script generated by Re_Sync 2"));
+    named.text = "0";
+    script.header.append(named);
+
+    named = Line::Named("ScaledBorderAndShadow");
+    named.text = "yes";
+    script.header.append(named);
 
-    // Идея: можно просто разбить файл, используя два перевода строки (и номер, и время) - медленно
+    named = Line::Named("Collisions");
+    named.text = "Normal";
+    script.header.append(named);
 
-    // Регулярка для определения секции
-    QRegularExpression reTime("^(\\d{2}:\\d{2}:\\d{2},\\d{3}) *--> *(\\d{2}:\\d{2}:\\d{2},\\d{3})$");
-    QRegularExpressionMatch match;
+    // Стиль по умолчанию
+    script.styles.append(Line::Style());
 
-    QString line;
-    QStringList tempList;
+    return true;
+}
+
+bool ParseSRT(const char* data, const qint64 size, EventHandler& handler, ParseProgress* progress)
+{
+    Tokenizer in(data, size);
+
+    // Пропускаем BOM UTF-8
+    if (size >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3)) in.seek(3);
+
+    // Текст фразы копится байтами и превращается в QString один раз
+    Span line, startTime, endTime;
+    QByteArray text;
     SRTState state = SRTST_EMPTY;
     bool isNumber;
     uint start = 0, end = 0;
+    Line::Event event;
+    const auto flush = [&]()
+    {
+        if (text.isEmpty()) return;
+
+        event.start = start;
+        event.end = end;
+        event.text = QString::fromUtf8(text);
+        handler.event(event);
+        text.clear();
+    };
+
+    ProgressReporter report(progress, size);
     while ( !in.atEnd() )
     {
-        line = in.readLine().trimmed();
+        if ( !report(in.pos()) ) return false;
+
+        line = in.readLine();
 
         switch (state)
         {
@@ -1028,12 +1541,12 @@ bool ParseSRT(QTextStream& in, Script& script)
             {
                 return false;
             }
-            else if ((match = reTime.match(line)).hasMatch())
+            else if (SplitSRTTiming(line, startTime, endTime))
             {
                 state = SRTST_TEXT;
 
-                start = Line::StrToTime(match.captured(1), SCR_SRT);
-                end   = Line::StrToTime(match.captured(2), SCR_SRT);
+                start = Line::StrToTime(startTime, SCR_SRT);
+                end   = Line::StrToTime(endTime, SCR_SRT);
             }
             else
             {
@@ -1046,65 +1559,33 @@ bool ParseSRT(QTextStream& in, Script& script)
             if (line.isEmpty())
             {
                 state = SRTST_EMPTY;
-
-                if (!tempList.isEmpty())
-                {
-                    Line::Event* ptr = new Line::Event();
-                    ptr->start = start;
-                    ptr->end = end;
-                    ptr->text = tempList.join("\\N");
-                    script.events.append(ptr);
-                    tempList.clear();
-                }
+                flush();
             }
             else
             {
-                tempList.append(line);
+                if (!text.isEmpty()) text.append("\\N", 2);
+                text.append(line.data(), line.size());
             }
             break;
         }
     }
-    if (!tempList.isEmpty())
-    {
-        Line::Event* ptr = new Line::Event();
-        ptr->start = start;
-        ptr->end = end;
-        ptr->text = tempList.join("\\N");
-        script.events.append(ptr);
-        tempList.clear();
-    }
+    flush();
 
-    // Важные заголовки
-    Line::Named* ptr = new Line::Named("WrapStyle", QStringList("; Script generated by Re_Sync 2"));
-    ptr->text = "0";
-    script.header.append(ptr);
-
-    ptr = new Line::Named("ScaledBorderAndShadow");
-    ptr->text = "yes";
-    script.header.append(ptr);
-
-    ptr = new Line::Named("Collisions");
-    ptr->text = "Normal";
-    script.header.append(ptr);
-
-    // Стиль по умолчанию
-    script.styles.append(new Line::Style());
-
-    return true;
+    return report.finish();
 }
 
 void GenerateSSA(QTextStream& out, const Script& script)
 {
-    out << script.generate(SCR_SSA);
+    script.generate(out, SCR_SSA);
 }
 
 void GenerateASS(QTextStream& out, const Script& script)
 {
-    out << script.generate(SCR_ASS);
+    script.generate(out, SCR_ASS);
 }
 
 void GenerateSRT(QTextStream& out, const Script& script)
 {
-    out << script.generate(SCR_SRT);
+    script.generate(out, SCR_SRT);
 }
 }
@@ -19,6 +19,8 @@
 #ifndef SCRIPT_H
 #define SCRIPT_H
 
+#include "names.h"
+#include "tokenizer.h"
 #include <QVector>
 #include <QList>
 #include <QString>
@@ -31,6 +33,20 @@ namespace Script
 enum ScriptType {SCR_UNKNOWN, SCR_ASS, SCR_SSA, SCR_SRT};
 enum SectionType {SEC_UNKNOWN, SEC_HEADER, SEC_STYLES, SEC_EVENTS, SEC_FONTS, SEC_GRAPHICS};
 
+// Поля строки события (маска)
+enum EventField
+{
+    EF_LAYER   = 0x01,
+    EF_START   = 0x02,
+    EF_END     = 0x04,
+    EF_STYLE   = 0x08,
+    EF_ACTOR   = 0x10,
+    EF_MARGINS = 0x20,
+    EF_EFFECT  = 0x40,
+    EF_TEXT    = 0x80,
+    EF_ALL     = 0xFF
+};
+
 namespace Sections
 {
 const QString header    = "Script Info";
@@ -49,8 +65,13 @@ const QVector<ushort> AlignmentASS = {0, 1, 2, 3, 9, 10, 11, 5, 6, 7};
 const QString defaultStyle = "Default";
 const QString defaultFont = "Arial";
 
+// Размер буфера для FormatTime
+const int TIME_BUFFER_SIZE = 16;
+
 uint StrToTime(const QString& str, const ScriptType type);
+uint StrToTime(const Span& str, const ScriptType type);
 QString TimeToStr(const uint time, const ScriptType type);
+char* FormatTime(char* buffer, const uint time, const ScriptType type);
 
 // Базовая строка
 class Base
@@ -59,7 +80,7 @@ public:
     Base();
     Base(const QString& value);
 
-    QString generate(const ScriptType type) const;
+    void generate(QTextStream& out, const ScriptType type) const;
 
 private:
     QString _value;
@@ -75,14 +96,16 @@ public:
     Named(const QString& name, const QStringList& before);
 
     void clearBefore();
+    void prependBefore(const QStringList& before);
     QString name() const;
-    QString generate(const ScriptType type) const;
+    void generate(QTextStream& out, const ScriptType type) const;
 
 protected:
     QString     _name;
     QStringList _before;
 
-    QString generate(const ScriptType type, const QString& value) const;
+    // Комментарии перед строкой и "Имя: "
+    void generateName(QTextStream& out) const;
 };
 
 // Строка стиля
@@ -116,7 +139,7 @@ public:
     Style();
     Style(const QStringList& before);
 
-    QString generate(const ScriptType type) const;
+    void generate(QTextStream& out, const ScriptType type) const;
 
 private:
     void init();
@@ -129,45 +152,43 @@ public:
     uint        layer;
     uint        start;
     uint        end;
-    QString     style;
-    QString     actorName;
+    Name        style;     // Пустое - стиль по умолчанию
+    Name        actorName;
     ushort      marginL;
     ushort      marginR;
     ushort      marginV;
-    QString     effect;
+    QString     effect; // Почти у каждой строки свой, не интернируется
 
     Event();
     Event(const QStringList& before);
 
-    QString generate(const ScriptType type) const;
+    void generate(QTextStream& out, const ScriptType type) const;
 
 private:
     void init();
 };
 }
+}
+
+// Строки можно перемещать в памяти побайтово
+Q_DECLARE_TYPEINFO(Script::Line::Base,  Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Script::Line::Named, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Script::Line::Style, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(Script::Line::Event, Q_MOVABLE_TYPE);
 
-// Секция в файле
+namespace Script
+{
+// Секция в файле: строки хранятся по значению в одном непрерывном блоке
 template <class T>
 class Section
 {
 public:
-    QList<T*> content;
+    QVector<T> content;
 
-    Section(const Section<T> &original) :
-        _sectionType(original._sectionType),
-        _after(original._after)
-    {
-        for (const T* const e : original.content) content.append(new T(*e));
-    }
     Section(const SectionType sectionType) :
         _sectionType(sectionType)
     {}
 
-    ~Section()
-    {
-        qDeleteAll(content);
-    }
-
     void clearAfter()
     {
         _after.clear();
@@ -175,11 +196,15 @@ public:
 
     void clear()
     {
-        qDeleteAll(content);
         content.clear();
         clearAfter();
     }
 
+    void reserve(const int size)
+    {
+        content.reserve(size);
+    }
+
     bool isEmpty() const
     {
         return content.isEmpty() && _after.isEmpty();
@@ -190,64 +215,73 @@ public:
         _after.append(after);
     }
 
-    void append(T* ptr)
+    void append(const T& line)
+    {
+        content.append(line);
+    }
+
+    void append(T&& line)
     {
-        content.append(ptr);
+        content.append(std::move(line));
     }
 
-    QString generate(const ScriptType type) const
+    void append(const QVector<T>& lines)
     {
-        QString result;
+        content.append(lines);
+    }
 
+    // Пишет прямо в поток, вся секция в памяти не собирается
+    void generate(QTextStream& out, const ScriptType type) const
+    {
         if (SCR_ASS == type || SCR_SSA == type)
         {
             switch (_sectionType)
             {
             case SEC_HEADER:
-                result.append( QString("[%1]\n").arg(Sections::header) );
+                out << '[' << Sections::header << "]\n";
                 break;
 
             case SEC_STYLES:
                 if (SCR_ASS == type)
                 {
-                    result.append( QString("[%1]\n").arg(Sections::stylesASS) );
-                    result.append("Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n");
+                    out << '[' << Sections::stylesASS << "]\n";
+                    out << "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n";
                 }
                 else
                 {
-                    result.append( QString("[%1]\n").arg(Sections::stylesSSA) );
-                    result.append("Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, TertiaryColour, BackColour, Bold, Italic, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, AlphaLevel, Encoding\n");
+                    out << '[' << Sections::stylesSSA << "]\n";
+                    out << "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, TertiaryColour, BackColour, Bold, Italic, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, AlphaLevel, Encoding\n";
                 }
                 break;
 
             case SEC_EVENTS:
-                result.append( QString("[%1]\n").arg(Sections::events) );
+                out << '[' << Sections::events << "]\n";
                 if (SCR_ASS == type)
                 {
-                    result.append("Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n");
+                    out << "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
                 }
                 else
                 {
-                    result.append("Format: Marked, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n");
+                    out << "Format: Marked, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
                 }
                 break;
 
             case SEC_FONTS:
-                result.append( QString("[%1]\n").arg(Sections::fonts) );
+                out << '[' << Sections::fonts << "]\n";
                 break;
 
             case SEC_GRAPHICS:
-                result.append( QString("[%1]\n").arg(Sections::graphics) );
+                out << '[' << Sections::graphics << "]\n";
                 break;
 
             default:
                 break;
             }
 
-            for (const T* const e : qAsConst(content))
+            for (const T& e : content)
             {
-                result.append( e->generate(type) );
-                result.append("\n");
+                e.generate(out, type);
+                out << '\n';
             }
 
             // Уродливый костыль
@@ -255,31 +289,28 @@ public:
             {
                 if (SCR_ASS == type)
                 {
-                    result.append("ScriptType: v4.00+\n");
+                    out << "ScriptType: v4.00+\n";
                 }
                 else
                 {
-                    result.append("ScriptType: v4.00\n");
+                    out << "ScriptType: v4.00\n";
                 }
             }
 
-            if (_after.length())
+            for (const QString& line : _after)
             {
-                result.append( _after.join("\n") );
-                result.append("\n");
+                out << line << '\n';
             }
         }
         else if (SCR_SRT == type && SEC_EVENTS == _sectionType)
         {
-            for (typename QList<T*>::size_type i = 0, len = content.length(); i < len; ++i)
+            for (int i = 0, len = content.length(); i < len; ++i)
             {
-                result.append( QString("%1\n").arg(i + 1) );
-                result.append( content.at(i)->generate(type) );
-                result.append("\n\n");
+                out << (i + 1) << '\n';
+                content.at(i).generate(out, type);
+                out << "\n\n";
             }
         }
-
-        return result;
     }
 
 private:
@@ -287,6 +318,34 @@ private:
     QStringList _after;
 };
 
+// Секция, которая не разбирается (вложенные шрифты и картинки):
+// строки хранятся одним куском байтов UTF-8, как в файле
+class RawSection
+{
+public:
+    QByteArray content;
+
+    RawSection(const SectionType sectionType) :
+        _sectionType(sectionType)
+    {}
+
+    void clear()
+    {
+        content.clear();
+    }
+
+    bool isEmpty() const
+    {
+        return content.isEmpty();
+    }
+
+    void append(const Span& data);
+    void generate(QTextStream& out, const ScriptType type) const;
+
+private:
+    SectionType _sectionType;
+};
+
 // Скрипт
 class Script
 {
@@ -296,14 +355,15 @@ public:
     Section<Line::Named>  header;
     Section<Line::Style>  styles;
     Section<Line::Event>  events;
-    Section<Line::Base>   fonts;
-    Section<Line::Base>   graphics;
+    RawSection            fonts;
+    RawSection            graphics;
 
     void clearBefore();
     void clearAfter();
     void clear();
     void appendBefore(const QStringList& before);
     void appendAfter(const QStringList& after);
+    void generate(QTextStream& out, const ScriptType type) const;
     QString generate(const ScriptType type) const;
 
 private:
@@ -311,9 +371,38 @@ private:
     QStringList _after;
 };
 
-ScriptType DetectFormat(QTextStream& in);
-bool ParseSSA(QTextStream& in, Script& script);
-bool ParseSRT(QTextStream& in, Script& script);
+// Получатель событий при потоковом разборе, без построения скрипта
+class EventHandler
+{
+public:
+    virtual ~EventHandler() {}
+    virtual void event(const Line::Event& event) = 0;
+};
+
+// Ход разбора: вызывается из потоков разбора, при параллельном разборе одновременно
+// из нескольких; false прерывает разбор
+class ParseProgress
+{
+public:
+    virtual ~ParseProgress() {}
+    virtual bool update(const qint64 done, const qint64 total) = 0;
+};
+
+// Параметры разбора
+struct ParseOptions
+{
+    bool parallel    = true;   // Большая секция событий разбирается на пуле потоков
+    int  fields      = EF_ALL; // Поля событий, которые нужно разобрать; остальные остаются по умолчанию,
+                               // и такой скрипт годится только для чтения
+    bool attachments = true;   // [Fonts] и [Graphics] сохранить одним куском, иначе пропустить
+    ParseProgress* progress = nullptr; // Сюда сообщается ход разбора, может отменить его
+};
+
+ScriptType DetectFormat(const char* data, const qint64 size);
+bool ParseSSA(const char* data, const qint64 size, Script& script, const ParseOptions& options = ParseOptions());
+bool ParseSSA(const char* data, const qint64 size, EventHandler& handler, const int fields = EF_ALL);
+bool ParseSRT(const char* data, const qint64 size, Script& script, ParseProgress* progress = nullptr);
+bool ParseSRT(const char* data, const qint64 size, EventHandler& handler, ParseProgress* progress = nullptr);
 void GenerateSSA(QTextStream& out, const Script& script);
 void GenerateASS(QTextStream& out, const Script& script);
 void GenerateSRT(QTextStream& out, const Script& script);
@@ -0,0 +1,171 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "source.h"
+#include <QTextCodec>
+
+
+namespace Script
+{
+namespace
+{
+// Кодировка определяется по началу файла, как и формат
+const qint64 UTF8_SNIFF_SIZE = 64 * 1024;
+
+// Проверка корректности UTF-8, ASCII проходит по 8 байт за раз.
+// partial - буфер обрезан, неполный символ в конце допустим.
+bool IsUtf8(const char* data, const qint64 size, const bool partial)
+{
+    const uchar* ptr = reinterpret_cast<const uchar*>(data);
+    const uchar* const end = ptr + size;
+    while (ptr < end)
+    {
+        if (end - ptr >= 8)
+        {
+            quint64 chunk;
+            memcpy(&chunk, ptr, sizeof(chunk));
+            if (0 == (chunk & Q_UINT64_C(0x8080808080808080)))
+            {
+                ptr += 8;
+                continue;
+            }
+        }
+
+        const uchar c = *ptr;
+        int len;
+        uint min;
+        if (c < 0x80)
+        {
+            ++ptr;
+            continue;
+        }
+        else if (0xC0 == (c & 0xE0)) { len = 2; min = 0x80; }
+        else if (0xE0 == (c & 0xF0)) { len = 3; min = 0x800; }
+        else if (0xF0 == (c & 0xF8)) { len = 4; min = 0x10000; }
+        else return false;
+
+        if (end - ptr < len) return partial;
+
+        uint code = c & (0x7Fu >> len);
+        for (int i = 1; i < len; ++i)
+        {
+            if (0x80 != (ptr[i] & 0xC0)) return false;
+            code = (code << 6) | (ptr[i] & 0x3Fu);
+        }
+        if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return false;
+
+        ptr += len;
+    }
+    return true;
+}
+}
+
+Source::Source() :
+    _data(nullptr),
+    _size(0),
+    _format(SCR_UNKNOWN),
+    _encoding(ENC_UTF8)
+{}
+
+bool Source::open(const QString& fileName)
+{
+    this->close();
+
+    _file.setFileName(fileName);
+    if ( !_file.open(QFile::ReadOnly) ) return false;
+
+    const qint64 size = _file.size();
+    if (const uchar* const data = size > 0 ? _file.map(0, size) : nullptr)
+    {
+        this->load(reinterpret_cast<const char*>(data), size);
+    }
+    else
+    {
+        _buffer = _file.readAll();
+        _file.close();
+        this->load(_buffer.constData(), _buffer.size());
+    }
+
+    return true;
+}
+
+void Source::setData(const QByteArray& data)
+{
+    this->close();
+
+    _buffer = data;
+    this->load(_buffer.constData(), _buffer.size());
+}
+
+void Source::close()
+{
+    // Отображение снимается вместе с закрытием файла
+    _file.close();
+    _buffer.clear();
+    _data     = nullptr;
+    _size     = 0;
+    _format   = SCR_UNKNOWN;
+    _encoding = ENC_UTF8;
+}
+
+void Source::load(const char* data, const qint64 size)
+{
+    _data     = data;
+    _size     = size;
+    _encoding = ENC_UTF8;
+
+    QTextCodec* codec = nullptr;
+    if (size >= 3 && 0 == memcmp(data, "\xEF\xBB\xBF", 3))
+    {
+        // BOM UTF-8 просто пропускаем
+        _data += 3;
+        _size -= 3;
+    }
+    else if (size >= 2 && 0 == memcmp(data, "\xFF\xFE", 2))
+    {
+        _encoding = ENC_UTF16LE;
+        codec = QTextCodec::codecForName("UTF-16LE");
+        _data += 2;
+        _size -= 2;
+    }
+    else if (size >= 2 && 0 == memcmp(data, "\xFE\xFF", 2))
+    {
+        _encoding = ENC_UTF16BE;
+        codec = QTextCodec::codecForName("UTF-16BE");
+        _data += 2;
+        _size -= 2;
+    }
+    else if ( !IsUtf8(data, qMin(size, UTF8_SNIFF_SIZE), size > UTF8_SNIFF_SIZE) )
+    {
+        // Как раньше у QTextStream: кодировка системы
+        _encoding = ENC_LOCALE;
+        codec = QTextCodec::codecForLocale();
+    }
+
+    // Перекодируем один раз, дальше все работают с UTF-8
+    if (nullptr != codec)
+    {
+        _buffer = codec->toUnicode(_data, static_cast<int>(_size)).toUtf8();
+        _file.close();
+        _data = _buffer.constData();
+        _size = _buffer.size();
+    }
+
+    _format = DetectFormat(_data, _size);
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include "script.h"
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+
+namespace Script
+{
+enum TextEncoding {ENC_UTF8, ENC_UTF16LE, ENC_UTF16BE, ENC_LOCALE};
+
+// Расширения файлов субтитров, без учёта регистра: общие для окна и пакетного режима
+const QStringList FILETYPES = {"ass", "ssa", "srt"};
+
+// Содержимое файла субтитров в UTF-8 и его формат. Файл читается (или отображается
+// в память) один раз, по этому же буферу определяется формат и идёт разбор.
+class Source
+{
+public:
+    Source();
+
+    bool open(const QString& fileName);
+    void setData(const QByteArray& data);
+    void close();
+
+    // Байты UTF-8 без BOM
+    const char* data() const { return _data; }
+    qint64 size() const { return _size; }
+
+    ScriptType format() const { return _format; }
+    TextEncoding encoding() const { return _encoding; }
+
+private:
+    void load(const char* data, const qint64 size);
+
+    QFile        _file;
+    QByteArray   _buffer;
+    const char*  _data;
+    qint64       _size;
+    ScriptType   _format;
+    TextEncoding _encoding;
+};
+}
+
+#endif // SOURCE_H
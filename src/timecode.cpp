@@ -0,0 +1,162 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "timecode.h"
+#include <QtMath>
+
+
+namespace Writer
+{
+namespace
+{
+// Стандартные NTSC-частоты: n * 1000/1001
+const uint NTSC_RATES[] = {24, 30, 48, 60, 120};
+
+// Больше не бывает, а тысячные такой частоты ещё помещаются в uint
+const double MAX_FPS = 1000.0;
+
+// Число с нулями впереди до width цифр
+QChar* WriteNumber(QChar* ptr, quint64 value, const int width)
+{
+    QChar digits[20];
+    int count = 0;
+    do
+    {
+        digits[count++] = QChar('0' + static_cast<int>(value % 10u));
+        value /= 10u;
+    } while (value > 0);
+
+    for (int i = count; i < width; ++i) *ptr++ = QChar('0');
+    while (count > 0) *ptr++ = digits[--count];
+    return ptr;
+}
+
+quint64 Gcd(quint64 a, quint64 b)
+{
+    while (0 != b)
+    {
+        const quint64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+}
+
+FrameRate FrameRate::fromDouble(const double fps)
+{
+    // Неверная частота (ноль, отрицательная, NaN): кадров нет, время без них
+    if (!(fps > 0.0 && fps <= MAX_FPS)) return {0u, 1u};
+
+    for (const uint rate : NTSC_RATES)
+    {
+        if (qAbs(fps - rate * 1000.0 / 1001.0) < 0.0005) return {rate * 1000u, 1001u};
+    }
+
+    // Остальное - с точностью до тысячных, как в поле ввода
+    const quint64 num = static_cast<quint64>(qRound64(fps * 1000.0));
+    const quint64 gcd = Gcd(num, 1000u);
+    return {static_cast<uint>(num / gcd), static_cast<uint>(1000u / gcd)};
+}
+
+Timecode::Timecode(const double fps, const int timeStart, const bool dropFrame) :
+    _rate(FrameRate::fromDouble(fps)),
+    _dropFrame(false),
+    _nominal((_rate.num + _rate.den / 2) / _rate.den)
+{
+    // Drop-frame бывает только у 29.97 и 59.94
+    _dropFrame = dropFrame && 1001u == _rate.den && (30u == _nominal || 60u == _nominal);
+
+    // Отделяем кадры от времени и пересчитываем их в миллисекунды (с округлением от нуля)
+    const int frames = timeStart % 1000;
+    const quint64 scaled = static_cast<quint64>(qAbs(frames)) * 1000u * _rate.den;
+    const qint64 frameMsec = 0u == _rate.num ? 0 : static_cast<qint64>((scaled + _rate.num - 1u) / _rate.num);
+
+    _offset = static_cast<qint64>(timeStart - frames) + (frames < 0 ? -frameMsec : frameMsec);
+}
+
+QChar* Timecode::format(QChar* buffer, const uint time) const
+{
+    qint64 value = static_cast<qint64>(time) + _offset;
+
+    // Запоминаем знак
+    QChar* ptr = buffer;
+    if (value < 0)
+    {
+        *ptr++ = QChar(0x2212); // "−"
+        value = -value;
+    }
+    const quint64 msec = static_cast<quint64>(value);
+
+    quint64 hour, min, sec, frame;
+    if (_dropFrame)
+    {
+        // SMPTE drop-frame: номера 0 и 1 (0-3 для 59.94) пропускаются каждую минуту, кроме каждой десятой
+        quint64 frames = msec * _rate.num / (1000u * static_cast<quint64>(_rate.den));
+        const quint64 drop      = _nominal / 15u;
+        const quint64 perMinute = _nominal * 60u - drop;
+        const quint64 perTen    = _nominal * 600u - drop * 9u;
+        const quint64 tens = frames / perTen, rest = frames % perTen;
+
+        frames += drop * 9u * tens;
+        if (rest > drop) frames += drop * ((rest - drop) / perMinute);
+
+        frame = frames % _nominal;
+        sec   = frames / _nominal % 60u;
+        min   = frames / (_nominal * 60u) % 60u;
+        hour  = frames / (_nominal * 3600u);
+    }
+    else
+    {
+        // Часы, минуты и секунды по часам, последний компонент - кадр внутри секунды
+        hour  = msec / 3600000u;
+        min   = msec / 60000u % 60u;
+        sec   = msec / 1000u  % 60u;
+        frame = msec % 1000u * _rate.num / (1000u * static_cast<quint64>(_rate.den));
+    }
+
+    ptr = WriteNumber(ptr, hour, 2);
+    *ptr++ = QChar(':');
+    ptr = WriteNumber(ptr, min, 2);
+    *ptr++ = QChar(':');
+    ptr = WriteNumber(ptr, sec, 2);
+    *ptr++ = QChar(_dropFrame ? ';' : ':');
+    return WriteNumber(ptr, frame, 2);
+}
+
+QString Timecode::toString(const uint time) const
+{
+    QChar buffer[SLOT_SIZE];
+    const QChar* const end = this->format(buffer, time);
+
+    return QString(buffer, static_cast<int>(end - buffer));
+}
+
+TimecodeList::TimecodeList(const Timecode& timecode, const QVector<uint>& times) :
+    _buffer(times.size() * Timecode::SLOT_SIZE),
+    _lengths(times.size())
+{
+    QChar* const buffer = _buffer.data();
+    int* const lengths = _lengths.data();
+    for (int i = 0, len = times.size(); i < len; ++i)
+    {
+        QChar* const slot = buffer + i * Timecode::SLOT_SIZE;
+        lengths[i] = static_cast<int>(timecode.format(slot, times.at(i)) - slot);
+    }
+}
+}
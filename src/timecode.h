@@ -0,0 +1,79 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMECODE_H
+#define TIMECODE_H
+
+#include <QString>
+#include <QVector>
+
+
+namespace Writer
+{
+// Частота кадров точной дробью: 24000/1001, 30000/1001, 25/1...
+struct FrameRate
+{
+    uint num;
+    uint den;
+
+    static FrameRate fromDouble(const double fps);
+};
+
+// Перевод времени в "чч:мм:сс:кк" с учётом начала времён. Смещение считается один раз,
+// дальше только целочисленная арифметика.
+class Timecode
+{
+public:
+    // Ячейка буфера под одно время (знак, часы, три разделителя, кадры)
+    static const int SLOT_SIZE = 16;
+
+    Timecode(const double fps, const int timeStart, const bool dropFrame = false);
+
+    const FrameRate& rate() const { return _rate; }
+    bool dropFrame() const { return _dropFrame; }
+
+    // Пишет время в буфер и возвращает конец записанного
+    QChar* format(QChar* buffer, const uint time) const;
+    QString toString(const uint time) const;
+
+private:
+    FrameRate _rate;
+    qint64    _offset; // Начало времён в миллисекундах
+    bool      _dropFrame;
+    uint      _nominal; // Целая частота для drop-frame (30, 60)
+};
+
+// Пакет времён: переводится разом, строки лежат в одном буфере ячейками фиксированной ширины
+class TimecodeList
+{
+public:
+    TimecodeList(const Timecode& timecode, const QVector<uint>& times);
+
+    int size() const { return _lengths.size(); }
+    QString at(const int i) const
+    {
+        return QString::fromRawData(_buffer.constData() + i * Timecode::SLOT_SIZE, _lengths.at(i));
+    }
+
+private:
+    QVector<QChar> _buffer;
+    QVector<int>   _lengths;
+};
+}
+
+#endif // TIMECODE_H
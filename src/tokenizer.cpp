@@ -0,0 +1,190 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tokenizer.h"
+#include <QByteArray>
+
+
+namespace Script
+{
+namespace
+{
+inline char AsciiLower(const char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Беззнаковое число с проверкой переполнения
+quint64 ParseDigits(const char* ptr, const char* const end, const int base, const quint64 max, bool& ok)
+{
+    quint64 result = 0;
+    ok = ptr < end;
+    for (; ptr < end; ++ptr)
+    {
+        const char c = *ptr;
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (16 == base && c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (16 == base && c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else
+        {
+            ok = false;
+            break;
+        }
+
+        result = result * static_cast<quint64>(base) + static_cast<quint64>(digit);
+        if (result > max)
+        {
+            ok = false;
+            break;
+        }
+    }
+    return ok ? result : 0;
+}
+}
+
+Span Span::trimmed() const
+{
+    const char* begin = _data;
+    const char* end   = _data + _size;
+    while (begin < end && isSpace(*begin)) ++begin;
+    while (end > begin && isSpace(*(end - 1))) --end;
+    return Span(begin, static_cast<int>(end - begin));
+}
+
+bool Span::equals(const char* str) const
+{
+    const size_t len = strlen(str);
+    return static_cast<size_t>(_size) == len && 0 == qstrnicmp(_data, str, static_cast<uint>(len));
+}
+
+bool Span::equals(const QString& str) const
+{
+    if (str.size() != _size) return false;
+
+    for (int i = 0; i < _size; ++i)
+    {
+        const ushort c = str.at(i).unicode();
+        if (c > 0x7F || AsciiLower(_data[i]) != AsciiLower(static_cast<char>(c))) return false;
+    }
+    return true;
+}
+
+uint Span::toUInt(bool* ok) const
+{
+    const char* begin = _data;
+    if (begin < end() && '+' == *begin) ++begin;
+
+    bool success;
+    const quint64 result = ParseDigits(begin, end(), 10, 0xFFFFFFFFu, success);
+    if (nullptr != ok) *ok = success;
+    return static_cast<uint>(result);
+}
+
+ushort Span::toUShort(bool* ok) const
+{
+    const char* begin = _data;
+    if (begin < end() && '+' == *begin) ++begin;
+
+    bool success;
+    const quint64 result = ParseDigits(begin, end(), 10, 0xFFFFu, success);
+    if (nullptr != ok) *ok = success;
+    return static_cast<ushort>(result);
+}
+
+int Span::toInt(bool* ok) const
+{
+    const char* begin = _data;
+    bool negative = false;
+    if (begin < end() && ('+' == *begin || '-' == *begin))
+    {
+        negative = '-' == *begin;
+        ++begin;
+    }
+
+    bool success;
+    const quint64 result = ParseDigits(begin, end(), 10, negative ? 0x80000000u : 0x7FFFFFFFu, success);
+    if (nullptr != ok) *ok = success;
+    return negative ? static_cast<int>(-static_cast<qint64>(result)) : static_cast<int>(result);
+}
+
+uint Span::toHex(bool* ok) const
+{
+    bool success;
+    const quint64 result = ParseDigits(_data, end(), 16, 0xFFFFFFFFu, success);
+    if (nullptr != ok) *ok = success;
+    return static_cast<uint>(result);
+}
+
+double Span::toDouble(bool* ok) const
+{
+    // Редкий путь (только стили), поэтому без своего разбора
+    return QByteArray::fromRawData(_data, _size).toDouble(ok);
+}
+
+uint Span::digitsToUInt() const
+{
+    quint64 result = 0;
+    for (const char* ptr = _data; ptr < end(); ++ptr)
+    {
+        if (*ptr < '0' || *ptr > '9') continue;
+
+        result = result * 10u + static_cast<quint64>(*ptr - '0');
+        if (result > 0xFFFFFFFFu) return 0;
+    }
+    return static_cast<uint>(result);
+}
+
+Tokenizer::Tokenizer(const char* data, const qint64 size) :
+    _data(data),
+    _size(size),
+    _pos(0)
+{}
+
+Span Tokenizer::readLine()
+{
+    const char* const begin = _data + _pos;
+    const void* const ptr = memchr(begin, '\n', static_cast<size_t>(_size - _pos));
+    const char* const end = nullptr == ptr ? _data + _size : static_cast<const char*>(ptr);
+
+    _pos = (end - _data) + (nullptr == ptr ? 0 : 1);
+    return Span(begin, static_cast<int>(end - begin)).trimmed();
+}
+
+bool SectionName(const Span& line, Span& name)
+{
+    // Аналог "^\[([^\]]+?)\]$"
+    if (line.size() < 3 || !line.startsWith('[') || !line.endsWith(']')) return false;
+
+    const Span inner = line.mid(1, line.size() - 2);
+    if (-1 != inner.indexOf(']')) return false;
+
+    name = inner;
+    return true;
+}
+
+bool SplitNamed(const Span& line, Span& name, Span& value)
+{
+    const int pos = line.indexOf(':');
+    if (-1 == pos) return false;
+
+    name  = line.left(pos).trimmed();
+    value = line.mid(pos + 1).trimmed();
+    return true;
+}
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <QString>
+#include <cstring>
+
+
+namespace Script
+{
+// Фрагмент байтового буфера (UTF-8) без копирования
+class Span
+{
+public:
+    Span() :
+        _data(nullptr),
+        _size(0)
+    {}
+    Span(const char* data, const int size) :
+        _data(data),
+        _size(size)
+    {}
+
+    const char* data() const { return _data; }
+    const char* end() const { return _data + _size; }
+    int size() const { return _size; }
+    bool isEmpty() const { return _size <= 0; }
+    char at(const int i) const { return _data[i]; }
+
+    bool startsWith(const char c) const { return _size > 0 && _data[0] == c; }
+    bool endsWith(const char c) const { return _size > 0 && _data[_size - 1] == c; }
+
+    int indexOf(const char c, const int from = 0) const
+    {
+        if (from >= _size) return -1;
+        const void* const ptr = memchr(_data + from, c, static_cast<size_t>(_size - from));
+        return nullptr == ptr ? -1 : static_cast<int>(static_cast<const char*>(ptr) - _data);
+    }
+
+    Span left(const int n) const { return Span(_data, qBound(0, n, _size)); }
+    Span mid(const int pos) const { return pos >= _size ? Span() : Span(_data + pos, _size - pos); }
+    Span mid(const int pos, const int n) const { return mid(pos).left(n); }
+    Span trimmed() const;
+
+    // Сравнение без учёта регистра (только ASCII)
+    bool equals(const char* str) const;
+    bool equals(const QString& str) const;
+
+    // Материализация
+    QString toString() const { return QString::fromUtf8(_data, _size); }
+    QByteArray toByteArray() const { return QByteArray(_data, _size); }
+
+    // Числа, как у QString: при ошибке возвращается 0
+    uint toUInt(bool* ok = nullptr) const;
+    ushort toUShort(bool* ok = nullptr) const;
+    int toInt(bool* ok = nullptr) const;
+    uint toHex(bool* ok = nullptr) const;
+    double toDouble(bool* ok = nullptr) const;
+
+    // Число из одних цифр строки, остальные символы пропускаются ("Marked=1" -> 1)
+    uint digitsToUInt() const;
+
+    static bool isSpace(const char c)
+    {
+        return ' ' == c || '\t' == c || '\n' == c || '\r' == c || '\v' == c || '\f' == c;
+    }
+
+private:
+    const char* _data;
+    int         _size;
+};
+
+// Построчное чтение буфера, например отображённого через QFile::map
+class Tokenizer
+{
+public:
+    Tokenizer(const char* data, const qint64 size);
+
+    bool atEnd() const { return _pos >= _size; }
+    const char* data() const { return _data; }
+    qint64 pos() const { return _pos; }
+    qint64 size() const { return _size; }
+    void seek(const qint64 pos) { _pos = qBound<qint64>(0, pos, _size); }
+
+    // Следующая строка без перевода строки и пробелов по краям
+    Span readLine();
+
+private:
+    const char* _data;
+    qint64      _size;
+    qint64      _pos;
+};
+
+// Последовательное чтение полей, разделённых запятыми
+class FieldReader
+{
+public:
+    FieldReader(const Span& text) :
+        _pos(text.data()),
+        _end(text.end()),
+        _atEnd(false)
+    {}
+
+    bool atEnd() const { return _atEnd; }
+
+    // Следующее поле как есть, без обрезки
+    Span next()
+    {
+        const void* const ptr = _pos < _end ? memchr(_pos, ',', static_cast<size_t>(_end - _pos)) : nullptr;
+        const char* const end = nullptr == ptr ? _end : static_cast<const char*>(ptr);
+        const Span result(_pos, static_cast<int>(end - _pos));
+
+        if (nullptr == ptr)
+        {
+            _pos = _end;
+            _atEnd = true;
+        }
+        else
+        {
+            _pos = end + 1;
+        }
+        return result;
+    }
+
+    // Всё, что осталось, вместе с запятыми
+    Span rest() const { return Span(_pos, static_cast<int>(_end - _pos)); }
+
+private:
+    const char* _pos;
+    const char* _end;
+    bool        _atEnd;
+};
+
+// Строка вида "[Name]": возвращает имя секции
+bool SectionName(const Span& line, Span& name);
+
+// Строка вида "Name: value": возвращает обе части без пробелов по краям
+bool SplitNamed(const Span& line, Span& name, Span& value);
+}
+
+#endif // TOKENIZER_H
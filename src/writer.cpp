@@ -17,247 +17,568 @@
  */
 
 #include "writer.h"
-#include <QtMath>
+#include "source.h"
+#include "timecode.h"
 //#include <QMap>
 #include <QTextCodec>
-#include <QTextDocument>
-#include <QTextCursor>
-#include <QTextTable>
-//#include <QPrinter>
-#include <QRegularExpression>
+#include <QtConcurrent>
+#include <QPdfWriter>
+#include <QPainter>
+#include <QTextLayout>
 
 namespace Writer
 {
-QString TimeToPT(const uint time, const double fps, const int timeStart)
+namespace
 {
-    // Отделяем кадры от времени
-    const int frames = timeStart % 1000;
-    int newTime = static_cast<int>(time) + (timeStart - frames);
-
-    // Пересчитываем кадры в миллисекунды
-    const double tmpMsec = static_cast<double>(frames) * 1000.0 / fps;
-    newTime += tmpMsec < 0 ? qFloor(tmpMsec) : qCeil(tmpMsec);
-
-    // Запоминаем знак
-    const bool negative = newTime < 0;
-    newTime = abs(newTime);
-
-    // Делим на компоненты
-    const int hour = newTime / 3600000,
-              min  = newTime / 60000 % 60,
-              sec  = newTime / 1000  % 60,
-              msec = newTime % 1000;
-
-    // Собираем строку (последний компонент - кадры)
-    const QChar fillChar = '0';
-    return QString("%1%2:%3:%4:%5")
-            .arg(negative ? QString("−") : QString())
-            .arg(hour, 2, 10, fillChar)
-            .arg(min,  2, 10, fillChar)
-            .arg(sec,  2, 10, fillChar)
-            .arg(qFloor(static_cast<double>(msec) * fps / 1000.0), 2, 10, fillChar);
+// Ход записи сообщается раз в столько фраз
+const int PROGRESS_STEP = 256;
+
+inline void ReportProgress(SaveProgress* progress, const int done, const int total)
+{
+    if (nullptr != progress && (0 == done % PROGRESS_STEP || done == total)) progress->update(done, total);
 }
 
-// Удаляет теги из текста фраз, объединяет соседние и фильтрует по актёрам
-PhraseList PreparePhrases(const Script::Script& script, const QStringList& actors, const int joinInterval)
+// Очистка текста одного события, результат пишется на его место
+struct StripEventText
 {
-    const QRegularExpression assTags("\\{[^\\}]*?\\}");
+    const Script::Line::Event* events;
+    QString*                   texts;
 
-    PhraseList result;
-    Phrase phrase;
-    QString actor, text;
-    bool first = true;
-    for (const Script::Line::Event* const event : qAsConst(script.events.content))
+    void operator()(const int i) const
+    {
+        texts[i] = StripTags(events[i].text);
+    }
+};
+
+// Поле таблицы: в кавычки, только если внутри разделитель, кавычка или перевод строки
+void WriteField(QTextStream& out, const QString& field, const QChar separator)
+{
+    const QChar* const begin = field.constData();
+    const QChar* const end   = begin + field.size();
+
+    const QChar* ptr = begin;
+    while (ptr < end && *ptr != separator && '"' != *ptr && '\n' != *ptr && '\r' != *ptr) ++ptr;
+
+    if (ptr == end)
     {
-        actor = event->actorName.isEmpty() ? ACTOR_EMPTY : event->actorName; // Already trimmed
-        text  = event->text.trimmed().replace("\\N", " ", Qt::CaseInsensitive).replace(assTags, QString());
-
-        // Если интервал указан, фраза не первая, актёр совпадает и расстояние между фразами не более 5 сек.
-        if (!first &&
-            joinInterval > 0 &&
-            actor == phrase.actor &&
-            event->start >= phrase.end &&
-            event->start - phrase.end <= static_cast<uint>(joinInterval))
+        out << field;
+        return;
+    }
+
+    // Кавычки внутри удваиваются
+    out << '"';
+    const QChar* from = begin;
+    for (ptr = begin; ptr < end; ++ptr)
+    {
+        if ('"' != *ptr) continue;
+
+        out << QStringRef(&field, static_cast<int>(from - begin), static_cast<int>(ptr - from + 1)) << '"';
+        from = ptr + 1;
+    }
+    out << QStringRef(&field, static_cast<int>(from - begin), static_cast<int>(end - from)) << '"';
+}
+
+// Текст для HTML: спецсимволы заменяются сущностями, обычные куски пишутся как есть
+void WriteEscaped(QTextStream& out, const QString& text)
+{
+    const QChar* const begin = text.constData();
+    const QChar* const end   = begin + text.size();
+
+    const QChar* from = begin;
+    for (const QChar* ptr = begin; ptr < end; ++ptr)
+    {
+        const char* entity;
+        switch (ptr->unicode())
         {
-            phrase.end  = event->end;
-            phrase.text += " ";
-            phrase.text += text;
+        case '&': entity = "&amp;";  break;
+        case '<': entity = "&lt;";   break;
+        case '>': entity = "&gt;";   break;
+        case '"': entity = "&quot;"; break;
+        default: continue;
         }
-        else
+
+        out << QStringRef(&text, static_cast<int>(from - begin), static_cast<int>(ptr - from)) << entity;
+        from = ptr + 1;
+    }
+    out << QStringRef(&text, static_cast<int>(from - begin), static_cast<int>(end - from));
+}
+}
+
+QString ExportFileName(const QString& baseName, const QStringList& actors, const QString& suffix)
+{
+    QString fileName = baseName;
+    if (!actors.isEmpty())
+    {
+        // Имя актёра не должно ломать путь
+        QString names = actors.join(',');
+        for (const QChar c : QString("\\/:*?\"<>|"))
         {
-            if (!first) result.append(phrase);
+            names.replace(c, '_');
+        }
+        fileName.append(QString(" (%1)").arg(names));
+    }
+    fileName.append(QString(".%1").arg(suffix));
+
+    return fileName;
+}
+
+QString StripTags(const QString& text)
+{
+    // Результат не длиннее исходника: пишем в заранее выделенный буфер
+    QString result(text.size(), Qt::Uninitialized);
+    QChar* const begin = result.data();
+    QChar* out = begin;
+
+    const QChar* ptr = text.constData();
+    const QChar* const end = ptr + text.size();
+    bool space = true; // Пробел уже стоит (или это начало строки)
+    while (ptr < end)
+    {
+        const ushort c = ptr->unicode();
 
-            phrase.start = event->start;
-            phrase.end   = event->end;
-            phrase.actor = actor;
-            phrase.text  = text;
+        // Обычный текст копируется без лишних проверок
+        if (c > ' ' && c < 0x80 && '{' != c && '\\' != c)
+        {
+            *out++ = *ptr++;
+            space = false;
+            continue;
+        }
 
-            first = false;
+        // Блок тегов; незакрытая скобка остаётся текстом
+        if ('{' == c)
+        {
+            const QChar* close = ptr + 1;
+            while (close < end && '}' != close->unicode()) ++close;
+            if (close < end)
+            {
+                ptr = close + 1;
+                continue;
+            }
         }
+        // Переносы строк и неразрывный пробел
+        else if ('\\' == c && ptr + 1 < end)
+        {
+            const ushort next = ptr[1].unicode();
+            if ('N' == next || 'n' == next || 'h' == next)
+            {
+                if (!space) *out++ = QChar(' ');
+                space = true;
+                ptr += 2;
+                continue;
+            }
+        }
+        else if (ptr->isSpace())
+        {
+            if (!space) *out++ = QChar(' ');
+            space = true;
+            ++ptr;
+            continue;
+        }
+
+        *out++ = *ptr++;
+        space = false;
     }
-    if (!first) result.append(phrase);
 
-    if (!actors.isEmpty())
+    // Пробел в конце не нужен
+    if (space && out > begin) --out;
+
+    result.truncate(static_cast<int>(out - begin));
+    return result;
+}
+
+PhraseBuilder::PhraseBuilder(const QStringList& actors, const int joinInterval) :
+    _joinInterval(joinInterval),
+    _keep(false),
+    _first(true)
+{
+    _actors.reserve(actors.size());
+    for (const QString& actor : actors)
+    {
+        _actors.insert(actor.toCaseFolded());
+    }
+}
+
+// Каждое имя сверяется с выбором один раз, дальше ответ берётся по интернированному имени
+bool PhraseBuilder::isSelected(const Script::Name& actorName)
+{
+    if (_actors.isEmpty()) return true;
+
+    QHash<Script::Name, bool>::const_iterator it = _selected.constFind(actorName);
+    if (it == _selected.constEnd())
+    {
+        const QString actor = actorName.isEmpty() ? ACTOR_EMPTY : actorName.toString();
+        it = _selected.insert(actorName, _actors.contains(actor.toCaseFolded()));
+    }
+    return it.value();
+}
+
+void PhraseBuilder::event(const Script::Line::Event& event)
+{
+    this->join(event, nullptr);
+}
+
+void PhraseBuilder::event(const Script::Line::Event& event, const QString& text)
+{
+    this->join(event, &text);
+}
+
+void PhraseBuilder::join(const Script::Line::Event& event, const QString* text)
+{
+    // Если интервал указан, фраза не первая, актёр совпадает и расстояние между фразами не более 5 сек.
+    // Невыбранные актёры тоже участвуют в объединении, чтобы фразы выбранных склеивались как раньше.
+    if (!_first &&
+        _joinInterval > 0 &&
+        event.actorName == _actorName &&
+        event.start >= _phrase.end &&
+        event.start - _phrase.end <= static_cast<uint>(_joinInterval))
+    {
+        _phrase.end = event.end;
+        if (_keep)
+        {
+            _phrase.text += " ";
+            _phrase.text += nullptr == text ? StripTags(event.text) : *text;
+        }
+    }
+    else
+    {
+        this->flush();
+
+        _keep         = this->isSelected(event.actorName);
+        _phrase.start = event.start;
+        _phrase.end   = event.end;
+        _phrase.actor = _keep ? (event.actorName.isEmpty() ? ACTOR_EMPTY : event.actorName.toString()) : QString(); // Имя уже без пробелов по краям
+        _phrase.text  = _keep ? (nullptr == text ? StripTags(event.text) : *text) : QString();
+        _actorName    = event.actorName;
+
+        _first = false;
+    }
+}
+
+PhraseList PhraseBuilder::finish()
+{
+    this->flush();
+    _first = true;
+
+    PhraseList result;
+    result.swap(_result);
+    return result;
+}
+
+// Готовая фраза попадает в результат, только если её актёр выбран
+void PhraseBuilder::flush()
+{
+    if (!_first && _keep) _result.append(_phrase);
+}
+
+PhraseCache::PhraseCache() :
+    _joinInterval(0),
+    _valid(false)
+{}
+
+void PhraseCache::setScript(const Script::Script& script)
+{
+    QMutexLocker locker(&_mutex);
+    _events   = script.events.content;
+    _texts    = QVector<QString>(_events.size());
+    _stripped = QBitArray(_events.size());
+    _phrases.clear();
+    _valid    = false;
+}
+
+PhraseList PhraseCache::phrases(const QStringList& actors, const int joinInterval)
+{
+    QMutexLocker locker(&_mutex);
+    if (_valid && _joinInterval == joinInterval && _actors == actors) return _phrases;
+
+    PhraseBuilder builder(actors, joinInterval);
+
+    // Чистим только тексты выбранных актёров, которых ещё нет в кэше; каждый поток пишет в свою ячейку
+    QVector<int> pending;
+    for (int i = 0, len = _events.size(); i < len; ++i)
+    {
+        if (!_stripped.testBit(i) && builder.isSelected(_events.at(i).actorName)) pending.append(i);
+    }
+
+    const StripEventText strip {_events.constData(), _texts.data()};
+    if (pending.size() < PARALLEL_MIN_EVENTS)
+    {
+        for (const int i : qAsConst(pending)) strip(i);
+    }
+    else
+    {
+        QtConcurrent::blockingMap(pending, strip);
+    }
+    for (const int i : qAsConst(pending)) _stripped.setBit(i);
+
+    // Склейка идёт по всем событиям: невыбранные актёры тоже разрывают фразы
+    for (int i = 0, len = _events.size(); i < len; ++i)
     {
-        auto toRemove = [actors](const Phrase& phrase) {
-            return !actors.contains(phrase.actor, Qt::CaseInsensitive);
-        };
-        result.erase(std::remove_if(result.begin(), result.end(), toRemove),
-                     result.end());
+        builder.event(_events.at(i), _texts.at(i));
     }
 
+    _phrases      = builder.finish();
+    _actors       = actors;
+    _joinInterval = joinInterval;
+    _valid        = true;
+    return _phrases;
+}
+
+// Разовая сборка через тот же кэш, что и в окне: результат тот же, что и в один поток
+PhraseList PreparePhrases(const Script::Script& script, const QStringList& actors, const int joinInterval)
+{
+    PhraseCache cache;
+    cache.setScript(script);
+    return cache.phrases(actors, joinInterval);
+}
+
+QHash<QString, PhraseList> SplitByActor(const PhraseList& phrases)
+{
+    QHash<QString, PhraseList> result;
+    for (const Phrase& phrase : phrases)
+    {
+        result[phrase.actor.toCaseFolded()].append(phrase);
+    }
     return result;
 }
 
-bool SaveSV(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval, const QChar separator)
+// Фразы прямо из файла: события идут в PhraseBuilder, скрипт целиком не строится
+bool ReadPhrases(const QString& fileName, const QStringList& actors, const int joinInterval, PhraseList& phrases)
 {
-    const PhraseList phrases = PreparePhrases(script, actors, joinInterval);
+    Script::Source source;
+    if ( !source.open(fileName) ) return false;
+
+    PhraseBuilder builder(actors, joinInterval);
+    bool success = false;
+    switch (source.format())
+    {
+    case Script::SCR_SSA:
+    case Script::SCR_ASS:
+        success = Script::ParseSSA(source.data(), source.size(), builder, PHRASE_FIELDS);
+        break;
+
+    case Script::SCR_SRT:
+        success = Script::ParseSRT(source.data(), source.size(), builder);
+        break;
+
+    default:
+        break;
+    }
+    source.close();
+
+    if (success) phrases = builder.finish();
+    return success;
+}
+
+bool SaveSV(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QChar separator, SaveProgress* progress)
+{
+    QFile fout(fileName);
+    if (!fout.open(QFile::WriteOnly | QFile::Text)) return false;
+
+    // Строки сразу уходят в буферизованный поток, весь файл в памяти не собирается
+    QTextStream out(&fout);
+    out.setCodec( QTextCodec::codecForName("UTF-8") );
+    out.setGenerateByteOrderMark(true);
+
+    // Все времена переводятся одним пакетом, смещение начала времён считается один раз
+    const Timecode timecode(fps, timeStart);
+    QVector<uint> times;
+    times.reserve(phrases.size() * 2);
+    for (const Phrase& phrase : phrases)
+    {
+        times.append(phrase.start);
+        times.append(phrase.end);
+    }
+    const TimecodeList timecodes(timecode, times);
 
     // const int width = QString::number(rows.size()).size();
     // QMap<QString, uint> counters;
     // uint counter;
     // QString id;
     QString prevActor;
-    QStringList line;
-    QString result;
-    for (const Phrase& phrase : phrases)
+    for (int i = 0, len = phrases.size(); i < len; ++i)
     {
+        ReportProgress(progress, i, len);
+        const Phrase& phrase = phrases.at(i);
+
         // counter = counters.value(row->actor, 0) + 1;
         // counters[row->actor] = counter;
         // id = QString("%1%2").arg(row->actor).arg(counter, width, 10, QChar('0'));
 
         if (separator == SEP_CSV)
         {
-            line.append( TimeToPT(phrase.start, fps, timeStart) );
-            line.append( TimeToPT(phrase.end, fps, timeStart) );
-            line.append( phrase.actor != prevActor ? phrase.actor : QString() );
-            line.append( phrase.text );
+            WriteField(out, timecodes.at(i * 2), separator);
+            out << separator;
+            WriteField(out, timecodes.at(i * 2 + 1), separator);
+            out << separator;
+            WriteField(out, phrase.actor != prevActor ? phrase.actor : QString(), separator);
+            out << separator;
+            WriteField(out, phrase.text, separator);
         }
         else if (separator == SEP_TSV)
         {
-            line.append( phrase.actor );
-            line.append( TimeToPT(phrase.start, fps, timeStart) );
+            WriteField(out, phrase.actor, separator);
+            out << separator;
+            WriteField(out, timecodes.at(i * 2), separator);
         }
-
-        for (QString& str : line)
-        {
-            str.replace('"', "\"\"").prepend('"').append('"');
-        }
-
-        result.append( line.join(separator) );
-        result.append( "\n" );
-        line.clear();
+        out << '\n';
 
         prevActor = phrase.actor;
     }
+    ReportProgress(progress, phrases.size(), phrases.size());
 
-    QFile fout(fileName);
-    if (!fout.open(QFile::WriteOnly | QFile::Text)) return false;
-
-    QTextStream out(&fout);
-    out.setCodec( QTextCodec::codecForName("UTF-8") );
-    out.setGenerateByteOrderMark(true);
-    out << result;
-
+    out.flush();
     fout.close();
-    return true;
+    return out.status() == QTextStream::Ok && fout.error() == QFile::NoError;
 }
 
-/*void SavePDF(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval)
+// Страницы раскладываются по ходу: фраза верстается отдельно и сразу рисуется,
+// готовые страницы уходят в файл, весь документ в памяти не строится
+bool SavePDF(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QString& title, SaveProgress* progress)
 {
-    const PhraseList phrases = PreparePhrases(script, actors, joinInterval);
+    QPdfWriter writer(fileName);
+    writer.setTitle(title);
+    writer.setCreator("DSCreator");
+    writer.setPageSize(QPageSize(QPageSize::A4));
+    writer.setPageMargins(QMarginsF(15.0, 15.0, 15.0, 15.0), QPageLayout::Millimeter);
+
+    QPainter painter;
+    if (!painter.begin(&writer)) return false;
 
-    QTextDocument document;
-    QFont font = document.defaultFont();
+    QFont font("Helvetica");
     font.setStyleHint(QFont::SansSerif);
-    font.setFamily("Helvetica");
     font.setPointSize(14);
-    document.setDefaultFont(font);
-    QTextCursor cursor(&document);
+    QFont bold(font);
+    bold.setBold(true);
 
-    // const int width = QString::number(_rows.size()).size();
-    // QMap<QString, uint> counters;
-    // uint counter;
+    const QFontMetricsF boldMetrics(bold, &writer);
+    const QFontMetricsF metrics(font, &writer);
+    const qreal width  = writer.width();
+    const qreal height = writer.height();
+
+    const Timecode timecode(fps, timeStart);
+    qreal y = 0.0;
     bool first = true;
-    for (const Phrase& phrase : phrases)
+    for (int n = 0, len = phrases.size(); n < len; ++n)
     {
-        // counter = counters.value(row->actor, 0) + 1;
-        // counters[row->actor] = counter;
-        // .arg(counter, width, 10, QChar('0'))
+        ReportProgress(progress, n, len);
+        const Phrase& phrase = phrases.at(n);
 
-        if (!first)
+        // Текст фразы по строкам ширины страницы
+        QTextLayout layout(phrase.text, font, &writer);
+        layout.beginLayout();
+        for (QTextLine line = layout.createLine(); line.isValid(); line = layout.createLine())
         {
-            cursor.insertBlock();
-            cursor.insertBlock();
+            line.setLineWidth(width);
+            line.setPosition(QPointF());
         }
+        layout.endLayout();
 
-        cursor.insertHtml( QString("<b>%1</b> %2<br/>%3")
-                           .arg(phrase.actor)
-                           .arg(TimeToPT(phrase.start, fps, timeStart))
-                           .arg(phrase.text) );
-
+        // Пустая строка между фразами
+        if (!first) y += metrics.lineSpacing();
         first = false;
-    }
-
-    QPrinter printer(QPrinter::HighResolution);
-    printer.setOutputFormat(QPrinter::PdfFormat);
-    printer.setPaperSize(QPrinter::A4);
-    printer.setOutputFileName(fileName);
-    document.print(&printer);
-}*/
 
-bool SaveHTML(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval, const QString& title)
-{
-    const PhraseList phrases = PreparePhrases(script, actors, joinInterval);
+        // Заголовок не отрывается от первой строки текста
+        const qreal firstLine = layout.lineCount() > 0 ? layout.lineAt(0).height() : 0.0;
+        if (y > 0.0 && y + boldMetrics.lineSpacing() + firstLine > height)
+        {
+            writer.newPage();
+            y = 0.0;
+        }
 
-    QTextDocument document;
-    document.setMetaInformation(QTextDocument::DocumentTitle, title);
-    QFont font = document.defaultFont();
-    font.setStyleHint(QFont::SansSerif);
-    font.setFamily("Arial");
-    font.setPointSize(10);
-    document.setDefaultFont(font);
-    QTextCursor cursor(&document);
-
-    QTextTableFormat tableFormat;
-    tableFormat.setCellSpacing(0);
-    tableFormat.setCellPadding(5.0);
-    tableFormat.setWidth(QTextLength(QTextLength::PercentageLength, 100.0));
-    tableFormat.setColumnWidthConstraints({
-        QTextLength(QTextLength::PercentageLength, 1.0),
-        QTextLength(QTextLength::PercentageLength, 1.0),
-        QTextLength(QTextLength::PercentageLength, 98.0)
-    });
-
-    QTextTable* table = cursor.insertTable(phrases.size() + 1, 3, tableFormat);
-    table->cellAt(0, 0).firstCursorPosition().insertText("Актёры");
-    table->mergeCells(0, 0, 1, 3);
-
-    for (int i = 0; i < phrases.size(); ++i)
-    {
-        const Phrase& phrase = phrases.at(i);
-        const int row = i + 1;
+        // Актёр и время
+        painter.setFont(bold);
+        painter.drawText(QPointF(0.0, y + boldMetrics.ascent()), phrase.actor);
+        painter.setFont(font);
+        painter.drawText(QPointF(boldMetrics.horizontalAdvance(phrase.actor + ' '), y + boldMetrics.ascent()), timecode.toString(phrase.start));
+        y += boldMetrics.lineSpacing();
 
-        table->cellAt(row, 0).firstCursorPosition().insertText(TimeToPT(phrase.start, fps, timeStart));
-        table->cellAt(row, 1).firstCursorPosition().insertText(phrase.actor);
-        table->cellAt(row, 2).firstCursorPosition().insertText(phrase.text);
+        for (int i = 0; i < layout.lineCount(); ++i)
+        {
+            const QTextLine line = layout.lineAt(i);
+            if (y > 0.0 && y + line.height() > height)
+            {
+                writer.newPage();
+                y = 0.0;
+            }
+            line.draw(&painter, QPointF(0.0, y));
+            y += line.height();
+        }
     }
+    ReportProgress(progress, phrases.size(), phrases.size());
 
-    QString html = document.toHtml("utf-8");
-    html.insert(html.indexOf("</style>"),
-                "body { font: 10pt Arial, Helvetica, sans-serif; }\n"
-                "table { border-collapse: collapse; }\n"
-                "table, td { border: 1px solid black; }\n"
-                "td { vertical-align: bottom; }\n");
+    return painter.end();
+}
 
+// Таблица пишется в файл построчно, без модели документа, поэтому можно звать из любого потока
+bool SaveHTML(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QString& title, SaveProgress* progress)
+{
     QFile fout(fileName);
     if (!fout.open(QFile::WriteOnly | QFile::Text)) return false;
 
     QTextStream out(&fout);
     out.setCodec( QTextCodec::codecForName("UTF-8") );
-    out << html;
 
+    out << "<!DOCTYPE html>\n"
+           "<html>\n"
+           "<head>\n"
+           "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\" />\n"
+           "<title>";
+    WriteEscaped(out, title);
+    out << "</title>\n"
+           "<style type=\"text/css\">\n"
+           "body { font: 10pt Arial, Helvetica, sans-serif; }\n"
+           "table { border-collapse: collapse; width: 100%; }\n"
+           "table, td { border: 1px solid black; }\n"
+           "td { vertical-align: bottom; padding: 5px; }\n"
+           "</style>\n"
+           "</head>\n"
+           "<body>\n"
+           "<table cellspacing=\"0\" cellpadding=\"5\">\n"
+           "<col width=\"1%\" /><col width=\"1%\" /><col width=\"98%\" />\n"
+           "<tr><td colspan=\"3\">Актёры</td></tr>\n";
+
+    const Timecode timecode(fps, timeStart);
+    for (int i = 0, len = phrases.size(); i < len; ++i)
+    {
+        ReportProgress(progress, i, len);
+        const Phrase& phrase = phrases.at(i);
+
+        out << "<tr><td>";
+        WriteEscaped(out, timecode.toString(phrase.start));
+        out << "</td><td>";
+        WriteEscaped(out, phrase.actor);
+        out << "</td><td>";
+        WriteEscaped(out, phrase.text);
+        out << "</td></tr>\n";
+    }
+    ReportProgress(progress, phrases.size(), phrases.size());
+
+    out << "</table>\n"
+           "</body>\n"
+           "</html>\n";
+
+    out.flush();
     fout.close();
-    return true;
+    return out.status() == QTextStream::Ok && fout.error() == QFile::NoError;
+}
+
+// Один файл в формате задания
+bool Save(const ExportJob& job, const double fps, const int timeStart, SaveProgress* progress)
+{
+    switch (job.format)
+    {
+    case EXP_CSV:
+        return SaveSV(job.phrases, job.fileName, fps, timeStart, SEP_CSV, progress);
+
+    case EXP_TSV:
+        return SaveSV(job.phrases, job.fileName, fps, timeStart, SEP_TSV, progress);
+
+    case EXP_HTML:
+        return SaveHTML(job.phrases, job.fileName, fps, timeStart, job.title, progress);
+
+    case EXP_PDF:
+        return SavePDF(job.phrases, job.fileName, fps, timeStart, job.title, progress);
+    }
+    return false;
 }
 }
@@ -20,7 +20,13 @@
 #define WRITER_H
 
 #include "script.h"
+#include <QBitArray>
+#include <QHash>
 #include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
 #include <QString>
 
 namespace Writer
@@ -28,6 +34,15 @@ namespace Writer
 const QChar SEP_CSV = ';', SEP_TSV = '\t';
 const QString ACTOR_EMPTY = "[не размечено]";
 
+// Форматы выгрузки
+enum ExportFormat {EXP_CSV, EXP_TSV, EXP_HTML, EXP_PDF};
+
+// Поля событий, из которых строятся фразы
+const int PHRASE_FIELDS = Script::EF_START | Script::EF_END | Script::EF_ACTOR | Script::EF_TEXT;
+
+// С какого числа событий текст чистится на пуле потоков
+const int PARALLEL_MIN_EVENTS = 1000;
+
 struct Phrase
 {
     uint start;
@@ -37,9 +52,102 @@ struct Phrase
 };
 typedef QList<Phrase> PhraseList;
 
-bool SaveSV(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval, const QChar separator);
-//void SavePDF(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval);
-bool SaveHTML(const Script::Script& script, const QString& fileName, const QStringList& actors, const double fps, const int timeStart, const int joinInterval, const QString& title);
+inline bool operator==(const Phrase& a, const Phrase& b)
+{
+    return a.start == b.start && a.end == b.end && a.actor == b.actor && a.text == b.text;
+}
+
+inline bool operator!=(const Phrase& a, const Phrase& b)
+{
+    return !(a == b);
+}
+
+// Один файл выгрузки
+struct ExportJob
+{
+    ExportFormat format;
+    QString      fileName;
+    PhraseList   phrases;
+    QString      title; // Заголовок HTML и PDF
+};
+typedef QVector<ExportJob> ExportJobList;
+
+// Ход записи файла: вызывается из потока записи, сколько фраз из скольких уже записано
+class SaveProgress
+{
+public:
+    virtual ~SaveProgress() {}
+    virtual void update(const int done, const int total) = 0;
+};
+
+// Собирает фразы по мере поступления событий: удаляет теги, объединяет соседние и фильтрует по актёрам.
+// Фильтр проверяется до обработки текста, так что фразы невыбранных актёров почти ничего не стоят.
+class PhraseBuilder : public Script::EventHandler
+{
+public:
+    PhraseBuilder(const QStringList& actors, const int joinInterval);
+
+    void event(const Script::Line::Event& event) override;
+    void event(const Script::Line::Event& event, const QString& text); // Текст уже очищен StripTags
+    PhraseList finish();
+
+    bool isSelected(const Script::Name& actorName);
+
+private:
+    QSet<QString>             _actors;   // Выбранные актёры в свёрнутом регистре
+    QHash<Script::Name, bool> _selected; // Уже проверенные имена
+    const int    _joinInterval;
+    PhraseList   _result;
+    Phrase       _phrase;
+    Script::Name _actorName; // Актёр текущей фразы
+    bool         _keep;      // Текущая фраза пойдёт в результат
+    bool         _first;
+
+    void join(const Script::Line::Event& event, const QString* text);
+    void flush();
+};
+
+// Фразы одного скрипта для частых пересборок. Очищенный текст события запоминается,
+// поэтому смена интервала объединения или выбора актёров только заново склеивает фразы
+// (один проход по всем событиям, без инкрементной склейки), а StripTags вызывается
+// лишь для событий, которые раньше не выбирались. Можно звать из любого потока,
+// вызовы выполняются по очереди.
+class PhraseCache
+{
+public:
+    PhraseCache();
+
+    void setScript(const Script::Script& script);
+
+    PhraseList phrases(const QStringList& actors, const int joinInterval);
+
+private:
+    QMutex           _mutex;
+    QVector<Script::Line::Event> _events;
+    QVector<QString> _texts;    // Очищенный текст по индексу события
+    QBitArray        _stripped; // Какие тексты уже очищены
+    PhraseList       _phrases;
+    QStringList      _actors;
+    int              _joinInterval;
+    bool             _valid;
+};
+
+// Имя файла выгрузки: "имя (актёры).расширение"
+QString ExportFileName(const QString& baseName, const QStringList& actors, const QString& suffix);
+
+// Текст фразы за один проход: блоки {...} удаляются, \N, \n и \h становятся пробелами,
+// пробелы схлопываются и обрезаются по краям
+QString StripTags(const QString& text);
+
+PhraseList PreparePhrases(const Script::Script& script, const QStringList& actors, const int joinInterval);
+// Раскладывает фразы по актёрам за один проход (ключ - имя в свёрнутом регистре), порядок сохраняется
+QHash<QString, PhraseList> SplitByActor(const PhraseList& phrases);
+bool ReadPhrases(const QString& fileName, const QStringList& actors, const int joinInterval, PhraseList& phrases);
+
+bool SaveSV(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QChar separator, SaveProgress* progress = nullptr);
+bool SavePDF(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QString& title, SaveProgress* progress = nullptr);
+bool SaveHTML(const PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QString& title, SaveProgress* progress = nullptr);
+bool Save(const ExportJob& job, const double fps, const int timeStart, SaveProgress* progress = nullptr);
 }
 
 #endif // WRITER_H
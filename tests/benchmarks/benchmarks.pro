@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Замеры скорости: ./benchmarks (или make check)
+#
+#-------------------------------------------------
+
+TEMPLATE = app
+
+QT += core gui concurrent testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+SRC = $$PWD/../../src
+INCLUDEPATH += $$SRC
+
+SOURCES += \
+    tst_benchmarks.cpp \
+    $$SRC/names.cpp \
+    $$SRC/script.cpp \
+    $$SRC/source.cpp \
+    $$SRC/timecode.cpp \
+    $$SRC/tokenizer.cpp \
+    $$SRC/writer.cpp
+
+TARGET = benchmarks
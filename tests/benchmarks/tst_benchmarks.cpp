@@ -0,0 +1,305 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "script.h"
+#include "writer.h"
+#include <QtTest>
+#include <QtMath>
+#include <QTemporaryDir>
+#include <QTextCodec>
+
+using namespace Script;
+
+
+namespace
+{
+// Времён в одном проходе: событий в секунду = SAMPLE_SIZE / время прохода
+const int SAMPLE_SIZE = 10000;
+
+// Строк таблицы в одном файле: строк в секунду = PHRASE_COUNT / время прохода
+const int PHRASE_COUNT = 20000;
+
+// Прежние реализации, с которыми сравниваются быстрые пути
+uint LegacyStrToTime(const QString& str, const ScriptType type)
+{
+    uint hour = 0,
+         min  = 0,
+         sec  = 0,
+         msec = 0;
+    QStringList list = str.split(':');
+
+    if (!list.isEmpty())
+    {
+        hour = list.first().trimmed().toUInt();
+        list.removeFirst();
+    }
+
+    if (!list.isEmpty())
+    {
+        min = list.first().trimmed().toUInt();
+        list.removeFirst();
+    }
+
+    if (!list.isEmpty())
+    {
+        if (SCR_ASS == type || SCR_SSA == type) list = list.first().split('.');
+        else list = list.first().split(',');
+
+        if (!list.isEmpty())
+        {
+            sec = list.first().trimmed().toUInt();
+            list.removeFirst();
+        }
+
+        if (!list.isEmpty())
+        {
+            msec = list.first().trimmed().toUInt();
+            if (SCR_ASS == type || SCR_SSA == type) msec *= 10u;
+        }
+    }
+
+    return ((hour * 60u + min) * 60u + sec) * 1000u + msec;
+}
+
+QString LegacyTimeToStr(const uint time, const ScriptType type)
+{
+    const uint hour = time / 3600000u,
+               min  = time / 60000u % 60u,
+               sec  = time / 1000u  % 60u,
+               msec = time % 1000u;
+
+    if (SCR_ASS == type || SCR_SSA == type)
+    {
+        return QString("%1:%2:%3.%4").arg(hour).arg(min, 2, 10, QChar('0')).arg(sec, 2, 10, QChar('0')).arg(msec / 10u, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2:%3,%4").arg(hour, 2, 10, QChar('0')).arg(min, 2, 10, QChar('0')).arg(sec, 2, 10, QChar('0')).arg(msec, 3, 10, QChar('0'));
+}
+
+QString LegacyTimeToPT(const uint time, const double fps, const int timeStart)
+{
+    const int frames = timeStart % 1000;
+    int newTime = static_cast<int>(time) + (timeStart - frames);
+
+    const double tmpMsec = static_cast<double>(frames) * 1000.0 / fps;
+    newTime += tmpMsec < 0 ? qFloor(tmpMsec) : qCeil(tmpMsec);
+
+    const bool negative = newTime < 0;
+    newTime = abs(newTime);
+
+    const int hour = newTime / 3600000,
+              min  = newTime / 60000 % 60,
+              sec  = newTime / 1000  % 60,
+              msec = newTime % 1000;
+
+    const QChar fillChar = '0';
+    return QString("%1%2:%3:%4:%5")
+            .arg(negative ? QString("−") : QString())
+            .arg(hour, 2, 10, fillChar)
+            .arg(min,  2, 10, fillChar)
+            .arg(sec,  2, 10, fillChar)
+            .arg(qFloor(static_cast<double>(msec) * fps / 1000.0), 2, 10, fillChar);
+}
+
+// Прежняя запись таблицы: все поля в кавычках, файл целиком собирается в памяти
+bool LegacySaveSV(const Writer::PhraseList& phrases, const QString& fileName, const double fps, const int timeStart, const QChar separator)
+{
+    QString prevActor;
+    QStringList line;
+    QString result;
+    for (const Writer::Phrase& phrase : phrases)
+    {
+        if (separator == Writer::SEP_CSV)
+        {
+            line.append( LegacyTimeToPT(phrase.start, fps, timeStart) );
+            line.append( LegacyTimeToPT(phrase.end, fps, timeStart) );
+            line.append( phrase.actor != prevActor ? phrase.actor : QString() );
+            line.append( phrase.text );
+        }
+        else if (separator == Writer::SEP_TSV)
+        {
+            line.append( phrase.actor );
+            line.append( LegacyTimeToPT(phrase.start, fps, timeStart) );
+        }
+
+        for (QString& str : line)
+        {
+            str.replace('"', "\"\"").prepend('"').append('"');
+        }
+
+        result.append( line.join(separator) );
+        result.append( "\n" );
+        line.clear();
+
+        prevActor = phrase.actor;
+    }
+
+    QFile fout(fileName);
+    if (!fout.open(QFile::WriteOnly | QFile::Text)) return false;
+
+    QTextStream out(&fout);
+    out.setCodec( QTextCodec::codecForName("UTF-8") );
+    out.setGenerateByteOrderMark(true);
+    out << result;
+
+    fout.close();
+    return true;
+}
+
+// Фразы серии: актёры чередуются, часть текстов с запятыми и кавычками
+Writer::PhraseList SamplePhrases()
+{
+    const QStringList actors = {"Анна", "Борис", "Голос за кадром", "Толпа"};
+    const QStringList texts = {
+        "Обычная короткая реплика",
+        "Реплика; с разделителем и \"кавычками\"",
+        "Длинная реплика, которая занимает почти всю строку таблицы и не содержит ничего особенного"
+    };
+
+    Writer::PhraseList phrases;
+    phrases.reserve(PHRASE_COUNT);
+    for (int i = 0; i < PHRASE_COUNT; ++i)
+    {
+        const uint start = static_cast<uint>(i) * 2500u;
+        phrases.append({start, start + 2000u, actors.at(i / 3 % actors.size()), texts.at(i % texts.size())});
+    }
+    return phrases;
+}
+
+// Времена событий двухчасового фильма с шагом в пару секунд
+QVector<uint> SampleTimes()
+{
+    QVector<uint> times;
+    times.reserve(SAMPLE_SIZE);
+    for (int i = 0; i < SAMPLE_SIZE; ++i)
+    {
+        times.append(static_cast<uint>(i) * 719u % 7200000u / 10u * 10u);
+    }
+    return times;
+}
+}
+
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void strToTime_data();
+    void strToTime();
+    void timeToStr_data();
+    void timeToStr();
+    void saveSV_data();
+    void saveSV();
+};
+
+void Benchmarks::strToTime_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("ass-legacy") << static_cast<int>(SCR_ASS) << true;
+    QTest::newRow("ass")        << static_cast<int>(SCR_ASS) << false;
+    QTest::newRow("srt-legacy") << static_cast<int>(SCR_SRT) << true;
+    QTest::newRow("srt")        << static_cast<int>(SCR_SRT) << false;
+}
+
+void Benchmarks::strToTime()
+{
+    QFETCH(int, type);
+    QFETCH(bool, legacy);
+    const ScriptType scriptType = static_cast<ScriptType>(type);
+
+    QStringList strings;
+    for (const uint time : SampleTimes()) strings.append(LegacyTimeToStr(time, scriptType));
+
+    // Сначала убеждаемся, что результат не изменился
+    for (const QString& str : qAsConst(strings))
+    {
+        QCOMPARE(Line::StrToTime(str, scriptType), LegacyStrToTime(str, scriptType));
+    }
+
+    uint sum = 0;
+    QBENCHMARK
+    {
+        for (const QString& str : qAsConst(strings))
+        {
+            sum += legacy ? LegacyStrToTime(str, scriptType) : Line::StrToTime(str, scriptType);
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void Benchmarks::timeToStr_data()
+{
+    this->strToTime_data();
+}
+
+void Benchmarks::timeToStr()
+{
+    QFETCH(int, type);
+    QFETCH(bool, legacy);
+    const ScriptType scriptType = static_cast<ScriptType>(type);
+
+    const QVector<uint> times = SampleTimes();
+    for (const uint time : times)
+    {
+        QCOMPARE(Line::TimeToStr(time, scriptType), LegacyTimeToStr(time, scriptType));
+    }
+
+    int length = 0;
+    QBENCHMARK
+    {
+        for (const uint time : times)
+        {
+            length += legacy ? LegacyTimeToStr(time, scriptType).size() : Line::TimeToStr(time, scriptType).size();
+        }
+    }
+    QVERIFY(length > 0);
+}
+
+void Benchmarks::saveSV_data()
+{
+    QTest::addColumn<QChar>("separator");
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("csv-legacy") << Writer::SEP_CSV << true;
+    QTest::newRow("csv")        << Writer::SEP_CSV << false;
+    QTest::newRow("tsv-legacy") << Writer::SEP_TSV << true;
+    QTest::newRow("tsv")        << Writer::SEP_TSV << false;
+}
+
+void Benchmarks::saveSV()
+{
+    QFETCH(QChar, separator);
+    QFETCH(bool, legacy);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("sheet.txt");
+    const Writer::PhraseList phrases = SamplePhrases();
+
+    QBENCHMARK
+    {
+        const bool saved = legacy ? LegacySaveSV(phrases, fileName, 23.976, 0, separator)
+                                  : Writer::SaveSV(phrases, fileName, 23.976, 0, separator);
+        QVERIFY(saved);
+    }
+}
+
+QTEST_GUILESS_MAIN(Benchmarks)
+
+#include "tst_benchmarks.moc"
@@ -0,0 +1,256 @@
+/*
+ * This file is part of DSCreator.
+ * Copyright (C) 2014-2019  Andrey Efremov <duxus@yandex.ru>
+ *
+ * DSCreator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * DSCreator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with DSCreator.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "script.h"
+#include "writer.h"
+#include <QtTest>
+
+
+namespace
+{
+// Событий в тестовом скрипте: больше порога параллельной очистки текста
+const int EVENT_COUNT = 3000;
+
+// Тексты с тегами, переводами строк и лишними пробелами
+const char* const TEXTS[] = {
+    "{\\i1}Привет{\\i0}, мир",
+    "Первая строка\\NВторая строка",
+    "Неразрывный\\hпробел и  двойной   пробел",
+    "{\\pos(320,240)\\fad(100,200)}Позиция{\\b1} и жир{\\b0}",
+    "  Пробелы по краям  ",
+    "Строка\\nс мягким переносом",
+    "{комментарий без тегов}",
+    "Фигурная { без конца",
+    "Обычная реплика, без \"разметки\"; с разделителем"
+};
+
+// Актёры: с регистром, пробелами и пустой
+const char* const ACTORS[] = {"Анна", "анна", "Борис", "", "Голос за кадром", "Борис"};
+
+// Заголовок скрипта ASS до первой строки события
+const char* const HEADER =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Default,Arial,20,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,2,2,2,10,10,10,1\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+
+// Маленький скрипт с заранее известным результатом: теги, переносы, пробелы,
+// актёры в разном регистре и границы объединения (пауза ровно 1 с, 1.01 с, наложение)
+const char* const KNOWN_EVENTS =
+    "Dialogue: 0,0:00:01.00,0:00:02.00,Default,Анна,0,0,0,,{\\i1}Привет{\\i0}, мир\n"
+    "Dialogue: 0,0:00:03.00,0:00:04.00,Default,Анна,0,0,0,,Раз\\Nдва\\hтри\n"
+    "Dialogue: 0,0:00:05.01,0:00:06.00,Default,Анна,0,0,0,,  много   пробелов  \n"
+    "Dialogue: 0,0:00:06.50,0:00:07.00,Default,анна,0,0,0,,Другой регистр\n"
+    "Dialogue: 0,0:00:07.50,0:00:08.00,Default,Борис,0,0,0,,Мешает\n"
+    "Dialogue: 0,0:00:08.50,0:00:09.00,Default,анна,0,0,0,,После\\nБориса\n"
+    "Dialogue: 0,0:00:09.00,0:00:10.00,Default,,0,0,0,,{\\pos(1,2)}Без актёра\n"
+    "Dialogue: 0,0:00:09.50,0:00:11.00,Default,Анна,0,0,0,,Внахлёст\n"
+    "Dialogue: 0,0:00:11.00,0:00:12.00,Default,Анна,0,0,0,,Встык\n"
+    "Dialogue: 0,0:00:11.50,0:00:13.00,Default,Анна,0,0,0,,{незакрытая\n";
+
+// Скрипт ASS: фразы идут то встык, то с паузами, чтобы объединение срабатывало по-разному
+QByteArray MakeFixture()
+{
+    QByteArray data = HEADER;
+
+    const int textCount  = sizeof(TEXTS) / sizeof(TEXTS[0]);
+    const int actorCount = sizeof(ACTORS) / sizeof(ACTORS[0]);
+    uint time = 0;
+    for (int i = 0; i < EVENT_COUNT; ++i)
+    {
+        const uint start = time + static_cast<uint>(i % 7) * 500u;
+        const uint end   = start + 1000u + static_cast<uint>(i % 3) * 250u;
+        time = end;
+
+        data += "Dialogue: 0,";
+        data += Script::Line::TimeToStr(start, Script::SCR_ASS).toLatin1();
+        data += ',';
+        data += Script::Line::TimeToStr(end, Script::SCR_ASS).toLatin1();
+        data += ",Default,";
+        data += ACTORS[(i / 2) % actorCount];
+        data += ",0,0,0,,";
+        data += TEXTS[i % textCount];
+        data += '\n';
+    }
+    return data;
+}
+
+bool ParseFixture(const QByteArray& data, Script::Script& script)
+{
+    Script::ParseOptions options;
+    options.fields = Writer::PHRASE_FIELDS;
+    return Script::ParseSSA(data.constData(), data.size(), script, options);
+}
+
+// Сколько событий пойдёт на очистку текста при сборке с нуля
+int SelectedEvents(const Script::Script& script, const QStringList& actors)
+{
+    Writer::PhraseBuilder builder(actors, 0);
+    int result = 0;
+    for (const Script::Line::Event& event : script.events.content)
+    {
+        if (builder.isSelected(event.actorName)) ++result;
+    }
+    return result;
+}
+
+// Однопоточная сборка: каждое событие чистится и объединяется по очереди
+Writer::PhraseList SequentialPhrases(const Script::Script& script, const QStringList& actors, const int joinInterval)
+{
+    Writer::PhraseBuilder builder(actors, joinInterval);
+    for (const Script::Line::Event& event : script.events.content)
+    {
+        builder.event(event);
+    }
+    return builder.finish();
+}
+
+// Фразы в тот же вид, что уходит в файл
+QByteArray Serialize(const Writer::PhraseList& phrases)
+{
+    QByteArray result;
+    for (const Writer::Phrase& phrase : phrases)
+    {
+        result += QByteArray::number(phrase.start) + '\t' + QByteArray::number(phrase.end) + '\t';
+        result += phrase.actor.toUtf8() + '\t' + phrase.text.toUtf8() + '\n';
+    }
+    return result;
+}
+}
+
+class Phrases : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void knownPhrases_data();
+    void knownPhrases();
+    void parallelMatchesSequential_data();
+    void parallelMatchesSequential();
+
+private:
+    Script::Script      _script;
+    Writer::PhraseCache _cache; // Как в окне: одна на все строки, тексты копятся от строки к строке
+};
+
+void Phrases::initTestCase()
+{
+    QVERIFY(ParseFixture(MakeFixture(), _script));
+    QCOMPARE(_script.events.content.size(), EVENT_COUNT);
+
+    _cache.setScript(_script);
+}
+
+// Ожидаемые строки в виде Serialize: начало, конец, актёр, текст через табуляцию
+void Phrases::knownPhrases_data()
+{
+    QTest::addColumn<QStringList>("actors");
+    QTest::addColumn<int>("joinInterval");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("all") << QStringList() << 0 << QStringList({
+        "1000\t2000\tАнна\tПривет, мир",
+        "3000\t4000\tАнна\tРаз два три",
+        "5010\t6000\tАнна\tмного пробелов",
+        "6500\t7000\tанна\tДругой регистр",
+        "7500\t8000\tБорис\tМешает",
+        "8500\t9000\tанна\tПосле Бориса",
+        "9000\t10000\t" + Writer::ACTOR_EMPTY + "\tБез актёра",
+        "9500\t11000\tАнна\tВнахлёст",
+        "11000\t12000\tАнна\tВстык",
+        "11500\t13000\tАнна\t{незакрытая"});
+
+    QTest::newRow("all-joined") << QStringList() << 1000 << QStringList({
+        "1000\t4000\tАнна\tПривет, мир Раз два три",
+        "5010\t6000\tАнна\tмного пробелов",
+        "6500\t7000\tанна\tДругой регистр",
+        "7500\t8000\tБорис\tМешает",
+        "8500\t9000\tанна\tПосле Бориса",
+        "9000\t10000\t" + Writer::ACTOR_EMPTY + "\tБез актёра",
+        "9500\t12000\tАнна\tВнахлёст Встык",
+        "11500\t13000\tАнна\t{незакрытая"});
+
+    QTest::newRow("case-variants") << QStringList({"АННА"}) << 1000 << QStringList({
+        "1000\t4000\tАнна\tПривет, мир Раз два три",
+        "5010\t6000\tАнна\tмного пробелов",
+        "6500\t7000\tанна\tДругой регистр",
+        "8500\t9000\tанна\tПосле Бориса",
+        "9500\t12000\tАнна\tВнахлёст Встык",
+        "11500\t13000\tАнна\t{незакрытая"});
+
+    QTest::newRow("empty-actor") << QStringList({Writer::ACTOR_EMPTY}) << 1000 << QStringList({
+        "9000\t10000\t" + Writer::ACTOR_EMPTY + "\tБез актёра"});
+}
+
+void Phrases::knownPhrases()
+{
+    QFETCH(QStringList, actors);
+    QFETCH(int, joinInterval);
+    QFETCH(QStringList, expected);
+
+    Script::Script script;
+    QVERIFY(ParseFixture(QByteArray(HEADER) + KNOWN_EVENTS, script));
+
+    const QByteArray rows = (expected.join('\n') + '\n').toUtf8();
+    QCOMPARE(Serialize(Writer::PreparePhrases(script, actors, joinInterval)), rows);
+    QCOMPARE(Serialize(SequentialPhrases(script, actors, joinInterval)), rows);
+}
+
+void Phrases::parallelMatchesSequential_data()
+{
+    QTest::addColumn<QStringList>("actors");
+    QTest::addColumn<int>("joinInterval");
+    QTest::addColumn<bool>("parallel"); // Тексты чистятся на пуле потоков
+
+    QTest::newRow("all")             << QStringList() << 0 << true;
+    QTest::newRow("all-joined")      << QStringList() << 1000 << true;
+    QTest::newRow("one")             << QStringList({"Анна"}) << 0 << true;
+    QTest::newRow("one-joined")      << QStringList({"АННА"}) << 1500 << true;
+    QTest::newRow("empty-actor")     << QStringList({Writer::ACTOR_EMPTY}) << 1000 << false;
+    QTest::newRow("several-joined")  << QStringList({"Борис", "Голос за кадром"}) << 5000 << true;
+    QTest::newRow("unknown")         << QStringList({"Никто"}) << 1000 << false;
+}
+
+void Phrases::parallelMatchesSequential()
+{
+    QFETCH(QStringList, actors);
+    QFETCH(int, joinInterval);
+    QFETCH(bool, parallel);
+
+    // PreparePhrases собирает с нуля: на пул уходят все тексты выбранных актёров
+    QCOMPARE(SelectedEvents(_script, actors) >= Writer::PARALLEL_MIN_EVENTS, parallel);
+
+    const Writer::PhraseList expected = SequentialPhrases(_script, actors, joinInterval);
+    const Writer::PhraseList actual   = Writer::PreparePhrases(_script, actors, joinInterval);
+
+    QCOMPARE(actual.size(), expected.size());
+    QCOMPARE(Serialize(actual), Serialize(expected));
+
+    const Writer::PhraseList cached = _cache.phrases(actors, joinInterval);
+    QCOMPARE(Serialize(cached), Serialize(expected));
+}
+
+QTEST_GUILESS_MAIN(Phrases)
+
+#include "tst_phrases.moc"